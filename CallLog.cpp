@@ -0,0 +1,901 @@
+#include "CallLog.h"
+
+#include <fstream>
+#include <memory>
+#include <string.h>
+
+namespace Amd {
+namespace Internal {
+namespace {
+// Layout of a call log: "APLR", u32 version, u32 profile API, followed by one
+// entry per call. An entry is the call id as u8, the input arguments, the
+// returned status and, if the status is GPA_STATUS_OK, the output values.
+// Integers are stored as LEB128 varints, floating point values as raw little
+// endian bytes and strings as varint length followed by the characters.
+// Context pointers are not stored as they are meaningless outside the process.
+const char			LogMagic [4] = { 'A', 'P', 'L', 'R' };
+const std::uint32_t	LogVersion = 1;
+
+struct Call
+{
+	enum Enum
+	{
+		Initialize = 1,
+		Destroy,
+		OpenContext,
+		SelectContext,
+		CloseContext,
+		GetNumCounters,
+		GetCounterName,
+		GetCounterDataType,
+		GetCounterUsageType,
+		EnableCounter,
+		DisableCounter,
+		GetPassCount,
+		BeginSession,
+		EndSession,
+		BeginPass,
+		EndPass,
+		BeginSample,
+		EndSample,
+		GetEnabledCount,
+		GetEnabledIndex,
+		IsSessionReady,
+		GetSampleUInt64,
+		GetSampleUInt32,
+		GetSampleFloat32,
+		GetSampleFloat64
+	};
+};
+
+class LogWriter
+{
+public:
+	void Open (const std::string& filename, const ProfileApi::Enum api)
+	{
+		file_.open (filename, std::ios::binary | std::ios::trunc);
+
+		if (!file_) {
+			NIV_THROW (std::runtime_error ("Could not open call log: " + filename));
+		}
+
+		buffer_.append (LogMagic, sizeof (LogMagic));
+		Raw (LogVersion);
+		Raw (static_cast<std::uint32_t> (api));
+	}
+
+	void Begin (const Call::Enum call)
+	{
+		buffer_ += static_cast<char> (call);
+	}
+
+	void Varint (std::uint64_t value)
+	{
+		while (value >= 0x80) {
+			buffer_ += static_cast<char> ((value & 0x7F) | 0x80);
+			value >>= 7;
+		}
+		buffer_ += static_cast<char> (value);
+	}
+
+	template <typename T>
+	void Raw (const T value)
+	{
+		char bytes [sizeof (T)];
+		::memcpy (bytes, &value, sizeof (T));
+		buffer_.append (bytes, sizeof (T));
+	}
+
+	void String (const char* value)
+	{
+		const auto length = ::strlen (value);
+		Varint (length);
+		buffer_.append (value, length);
+	}
+
+	GPA_Status End (const GPA_Status status)
+	{
+		if (buffer_.size () >= FlushSize) {
+			Flush ();
+		}
+
+		return status;
+	}
+
+	void Flush ()
+	{
+		file_.write (buffer_.data (), buffer_.size ());
+		file_.flush ();
+		buffer_.clear ();
+	}
+
+private:
+	enum
+	{
+		FlushSize = 64 * 1024
+	};
+
+	std::ofstream	file_;
+	std::string		buffer_;
+};
+
+class LogReader
+{
+public:
+	LogReader ()
+	: offset_ (0)
+	, diverged_ (false)
+	{
+	}
+
+	void Open (const std::string& filename, const ProfileApi::Enum api)
+	{
+		std::ifstream file (filename, std::ios::binary | std::ios::ate);
+
+		if (!file) {
+			NIV_THROW (std::runtime_error ("Could not open call log: " + filename));
+		}
+
+		data_.resize (static_cast<std::size_t> (file.tellg ()));
+		file.seekg (0);
+		file.read (data_.data (), data_.size ());
+
+		if (data_.size () < sizeof (LogMagic)
+			|| ::memcmp (data_.data (), LogMagic, sizeof (LogMagic)) != 0) {
+			NIV_THROW (std::runtime_error ("Not a call log: " + filename));
+		}
+
+		offset_ = sizeof (LogMagic);
+
+		if (Raw<std::uint32_t> () != LogVersion) {
+			NIV_THROW (std::runtime_error ("Unsupported call log version: " + filename));
+		}
+
+		if (Raw<std::uint32_t> () != static_cast<std::uint32_t> (api)) {
+			NIV_THROW (std::runtime_error ("Call log was recorded for a different API: " + filename));
+		}
+	}
+
+	/**
+	Consume the call id of the next entry, which must be call. Pending
+	GPA_IsSessionReady entries are skipped for all other calls.
+	*/
+	bool Begin (const Call::Enum call)
+	{
+		if (call != Call::IsSessionReady) {
+			while (!diverged_ && offset_ < data_.size ()
+				&& data_ [offset_] == Call::IsSessionReady) {
+				++offset_;
+				Varint ();
+				if (Varint () == GPA_STATUS_OK) {
+					Raw<std::uint8_t> ();
+				}
+			}
+		}
+
+		if (!IsNext (call)) {
+			diverged_ = true;
+			return false;
+		}
+
+		++offset_;
+		return true;
+	}
+
+	bool IsNext (const Call::Enum call) const
+	{
+		return !diverged_ && offset_ < data_.size () && data_ [offset_] == call;
+	}
+
+	bool HasDiverged () const
+	{
+		return diverged_;
+	}
+
+	std::uint64_t Varint ()
+	{
+		std::uint64_t result = 0;
+
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (offset_ >= data_.size ()) {
+				break;
+			}
+
+			const auto byte = static_cast<std::uint8_t> (data_ [offset_++]);
+			result |= static_cast<std::uint64_t> (byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0) {
+				return result;
+			}
+		}
+
+		diverged_ = true;
+		return 0;
+	}
+
+	template <typename T>
+	T Raw ()
+	{
+		T result = T ();
+
+		if (offset_ + sizeof (T) > data_.size ()) {
+			diverged_ = true;
+		} else {
+			::memcpy (&result, data_.data () + offset_, sizeof (T));
+			offset_ += sizeof (T);
+		}
+
+		return result;
+	}
+
+	std::string String ()
+	{
+		const auto length = static_cast<std::size_t> (Varint ());
+
+		if (diverged_ || offset_ + length > data_.size ()) {
+			diverged_ = true;
+			return std::string ();
+		}
+
+		std::string result (data_.data () + offset_, length);
+		offset_ += length;
+		return result;
+	}
+
+	/**
+	Check that the next argument matches the recorded one.
+	*/
+	bool Expect (const std::uint64_t value)
+	{
+		if (Varint () != value) {
+			diverged_ = true;
+		}
+
+		return !diverged_;
+	}
+
+	GPA_Status Status ()
+	{
+		return static_cast<GPA_Status> (Varint ());
+	}
+
+	GPA_Status End (const GPA_Status status) const
+	{
+		return diverged_ ? GPA_STATUS_ERROR_FAILED : status;
+	}
+
+	const char* StoreName (const gpa_uint32 index, std::string&& name)
+	{
+		// Each name is stored once and map nodes are stable, so all pointers
+		// returned for an index remain valid like the ones from GPUPerfAPI
+		auto it = names_.find (index);
+
+		if (it == names_.end ()) {
+			it = names_.emplace (index, std::move (name)).first;
+		}
+
+		return it->second.c_str ();
+	}
+
+private:
+	std::vector<char>						data_;
+	std::size_t								offset_;
+	bool									diverged_;
+	std::map<gpa_uint32, std::string>		names_;
+};
+
+struct Recorder
+{
+	ImportTable	original;
+	LogWriter	log;
+};
+
+Recorder*	recorder = nullptr;
+LogReader*	replayer = nullptr;
+
+////////////////////////////////////////////////////////////////////////////////
+// Recording
+////////////////////////////////////////////////////////////////////////////////
+GPA_Status RecordInitialize ()
+{
+	const auto status = recorder->original.initialize ();
+	recorder->log.Begin (Call::Initialize);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordDestroy ()
+{
+	const auto status = recorder->original.destroy ();
+	recorder->log.Begin (Call::Destroy);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordOpenContext (void* context)
+{
+	const auto status = recorder->original.openContext (context);
+	recorder->log.Begin (Call::OpenContext);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordSelectContext (void* context)
+{
+	const auto status = recorder->original.selectContext (context);
+	recorder->log.Begin (Call::SelectContext);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordCloseContext ()
+{
+	const auto status = recorder->original.closeContext ();
+	recorder->log.Begin (Call::CloseContext);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetNumCounters (gpa_uint32* count)
+{
+	const auto status = recorder->original.getNumCounters (count);
+	recorder->log.Begin (Call::GetNumCounters);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*count);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetCounterName (gpa_uint32 index, const char** name)
+{
+	const auto status = recorder->original.getCounterName (index, name);
+	recorder->log.Begin (Call::GetCounterName);
+	recorder->log.Varint (index);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.String (*name);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetCounterDataType (gpa_uint32 index, GPA_Type* type)
+{
+	const auto status = recorder->original.getCounterDataType (index, type);
+	recorder->log.Begin (Call::GetCounterDataType);
+	recorder->log.Varint (index);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*type);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetCounterUsageType (gpa_uint32 index, GPA_Usage_Type* usage)
+{
+	const auto status = recorder->original.getCounterUsageType (index, usage);
+	recorder->log.Begin (Call::GetCounterUsageType);
+	recorder->log.Varint (index);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*usage);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordEnableCounter (gpa_uint32 index)
+{
+	const auto status = recorder->original.enableCounter (index);
+	recorder->log.Begin (Call::EnableCounter);
+	recorder->log.Varint (index);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordDisableCounter (gpa_uint32 index)
+{
+	const auto status = recorder->original.disableCounter (index);
+	recorder->log.Begin (Call::DisableCounter);
+	recorder->log.Varint (index);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetPassCount (gpa_uint32* count)
+{
+	const auto status = recorder->original.getPassCount (count);
+	recorder->log.Begin (Call::GetPassCount);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*count);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordBeginSession (gpa_uint32* sessionId)
+{
+	const auto status = recorder->original.beginSession (sessionId);
+	recorder->log.Begin (Call::BeginSession);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*sessionId);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordEndSession ()
+{
+	const auto status = recorder->original.endSession ();
+	recorder->log.Begin (Call::EndSession);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordBeginPass ()
+{
+	const auto status = recorder->original.beginPass ();
+	recorder->log.Begin (Call::BeginPass);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordEndPass ()
+{
+	const auto status = recorder->original.endPass ();
+	recorder->log.Begin (Call::EndPass);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordBeginSample (gpa_uint32 sampleId)
+{
+	const auto status = recorder->original.beginSample (sampleId);
+	recorder->log.Begin (Call::BeginSample);
+	recorder->log.Varint (sampleId);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordEndSample ()
+{
+	const auto status = recorder->original.endSample ();
+	recorder->log.Begin (Call::EndSample);
+	recorder->log.Varint (status);
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetEnabledCount (gpa_uint32* count)
+{
+	const auto status = recorder->original.getEnabledCount (count);
+	recorder->log.Begin (Call::GetEnabledCount);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*count);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetEnabledIndex (gpa_uint32 enabledNumber, gpa_uint32* index)
+{
+	const auto status = recorder->original.getEnabledIndex (enabledNumber, index);
+	recorder->log.Begin (Call::GetEnabledIndex);
+	recorder->log.Varint (enabledNumber);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*index);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordIsSessionReady (bool* ready, gpa_uint32 sessionId)
+{
+	const auto status = recorder->original.isSessionReady (ready, sessionId);
+	recorder->log.Begin (Call::IsSessionReady);
+	recorder->log.Varint (sessionId);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Raw (static_cast<std::uint8_t> (*ready ? 1 : 0));
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetSampleUInt64 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_uint64* result)
+{
+	const auto status = recorder->original.getSampleUInt64 (sessionId, sampleId, counterIndex, result);
+	recorder->log.Begin (Call::GetSampleUInt64);
+	recorder->log.Varint (sessionId);
+	recorder->log.Varint (sampleId);
+	recorder->log.Varint (counterIndex);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*result);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetSampleUInt32 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_uint32* result)
+{
+	const auto status = recorder->original.getSampleUInt32 (sessionId, sampleId, counterIndex, result);
+	recorder->log.Begin (Call::GetSampleUInt32);
+	recorder->log.Varint (sessionId);
+	recorder->log.Varint (sampleId);
+	recorder->log.Varint (counterIndex);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Varint (*result);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetSampleFloat32 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_float32* result)
+{
+	const auto status = recorder->original.getSampleFloat32 (sessionId, sampleId, counterIndex, result);
+	recorder->log.Begin (Call::GetSampleFloat32);
+	recorder->log.Varint (sessionId);
+	recorder->log.Varint (sampleId);
+	recorder->log.Varint (counterIndex);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Raw (*result);
+	}
+	return recorder->log.End (status);
+}
+
+GPA_Status RecordGetSampleFloat64 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_float64* result)
+{
+	const auto status = recorder->original.getSampleFloat64 (sessionId, sampleId, counterIndex, result);
+	recorder->log.Begin (Call::GetSampleFloat64);
+	recorder->log.Varint (sessionId);
+	recorder->log.Varint (sampleId);
+	recorder->log.Varint (counterIndex);
+	recorder->log.Varint (status);
+	if (status == GPA_STATUS_OK) {
+		recorder->log.Raw (*result);
+	}
+	return recorder->log.End (status);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Replay
+////////////////////////////////////////////////////////////////////////////////
+GPA_Status ReplayStatusOnly (const Call::Enum call)
+{
+	if (!replayer->Begin (call)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	return replayer->End (replayer->Status ());
+}
+
+template <typename T>
+GPA_Status ReplayVarintResult (const Call::Enum call, T* result)
+{
+	if (!replayer->Begin (call)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	const auto status = replayer->Status ();
+	if (status == GPA_STATUS_OK) {
+		*result = static_cast<T> (replayer->Varint ());
+	}
+	return replayer->End (status);
+}
+
+template <typename T>
+GPA_Status ReplayIndexedVarintResult (const Call::Enum call, const gpa_uint32 index, T* result)
+{
+	if (!replayer->Begin (call) || !replayer->Expect (index)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	const auto status = replayer->Status ();
+	if (status == GPA_STATUS_OK) {
+		*result = static_cast<T> (replayer->Varint ());
+	}
+	return replayer->End (status);
+}
+
+template <typename T>
+GPA_Status ReplaySample (const Call::Enum call, const gpa_uint32 sessionId,
+	const gpa_uint32 sampleId, const gpa_uint32 counterIndex, T* result, const bool raw)
+{
+	if (!replayer->Begin (call) || !replayer->Expect (sessionId)
+		|| !replayer->Expect (sampleId) || !replayer->Expect (counterIndex)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	const auto status = replayer->Status ();
+	if (status == GPA_STATUS_OK) {
+		*result = raw ? replayer->Raw<T> () : static_cast<T> (replayer->Varint ());
+	}
+	return replayer->End (status);
+}
+
+GPA_Status ReplayInitialize ()
+{
+	return ReplayStatusOnly (Call::Initialize);
+}
+
+GPA_Status ReplayDestroy ()
+{
+	return ReplayStatusOnly (Call::Destroy);
+}
+
+GPA_Status ReplayOpenContext (void*)
+{
+	return ReplayStatusOnly (Call::OpenContext);
+}
+
+GPA_Status ReplaySelectContext (void*)
+{
+	return ReplayStatusOnly (Call::SelectContext);
+}
+
+GPA_Status ReplayCloseContext ()
+{
+	return ReplayStatusOnly (Call::CloseContext);
+}
+
+GPA_Status ReplayGetNumCounters (gpa_uint32* count)
+{
+	return ReplayVarintResult (Call::GetNumCounters, count);
+}
+
+GPA_Status ReplayGetCounterName (gpa_uint32 index, const char** name)
+{
+	if (!replayer->Begin (Call::GetCounterName) || !replayer->Expect (index)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	const auto status = replayer->Status ();
+	if (status == GPA_STATUS_OK) {
+		*name = replayer->StoreName (index, replayer->String ());
+	}
+	return replayer->End (status);
+}
+
+GPA_Status ReplayGetCounterDataType (gpa_uint32 index, GPA_Type* type)
+{
+	return ReplayIndexedVarintResult (Call::GetCounterDataType, index, type);
+}
+
+GPA_Status ReplayGetCounterUsageType (gpa_uint32 index, GPA_Usage_Type* usage)
+{
+	return ReplayIndexedVarintResult (Call::GetCounterUsageType, index, usage);
+}
+
+GPA_Status ReplayEnableCounter (gpa_uint32 index)
+{
+	if (!replayer->Begin (Call::EnableCounter) || !replayer->Expect (index)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	return replayer->End (replayer->Status ());
+}
+
+GPA_Status ReplayDisableCounter (gpa_uint32 index)
+{
+	if (!replayer->Begin (Call::DisableCounter) || !replayer->Expect (index)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	return replayer->End (replayer->Status ());
+}
+
+GPA_Status ReplayGetPassCount (gpa_uint32* count)
+{
+	return ReplayVarintResult (Call::GetPassCount, count);
+}
+
+GPA_Status ReplayBeginSession (gpa_uint32* sessionId)
+{
+	return ReplayVarintResult (Call::BeginSession, sessionId);
+}
+
+GPA_Status ReplayEndSession ()
+{
+	return ReplayStatusOnly (Call::EndSession);
+}
+
+GPA_Status ReplayBeginPass ()
+{
+	return ReplayStatusOnly (Call::BeginPass);
+}
+
+GPA_Status ReplayEndPass ()
+{
+	return ReplayStatusOnly (Call::EndPass);
+}
+
+GPA_Status ReplayBeginSample (gpa_uint32 sampleId)
+{
+	if (!replayer->Begin (Call::BeginSample) || !replayer->Expect (sampleId)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	return replayer->End (replayer->Status ());
+}
+
+GPA_Status ReplayEndSample ()
+{
+	return ReplayStatusOnly (Call::EndSample);
+}
+
+GPA_Status ReplayGetEnabledCount (gpa_uint32* count)
+{
+	return ReplayVarintResult (Call::GetEnabledCount, count);
+}
+
+GPA_Status ReplayGetEnabledIndex (gpa_uint32 enabledNumber, gpa_uint32* index)
+{
+	return ReplayIndexedVarintResult (Call::GetEnabledIndex, enabledNumber, index);
+}
+
+GPA_Status ReplayIsSessionReady (bool* ready, gpa_uint32 sessionId)
+{
+	if (replayer->HasDiverged ()) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	if (!replayer->IsNext (Call::IsSessionReady)) {
+		// The recording polled less often, so the session was ready by now
+		*ready = true;
+		return GPA_STATUS_OK;
+	}
+
+	replayer->Begin (Call::IsSessionReady);
+
+	if (!replayer->Expect (sessionId)) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	const auto status = replayer->Status ();
+	if (status == GPA_STATUS_OK) {
+		*ready = replayer->Raw<std::uint8_t> () != 0;
+	}
+	return replayer->End (status);
+}
+
+GPA_Status ReplayGetSampleUInt64 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_uint64* result)
+{
+	return ReplaySample (Call::GetSampleUInt64, sessionId, sampleId, counterIndex, result, false);
+}
+
+GPA_Status ReplayGetSampleUInt32 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_uint32* result)
+{
+	return ReplaySample (Call::GetSampleUInt32, sessionId, sampleId, counterIndex, result, false);
+}
+
+GPA_Status ReplayGetSampleFloat32 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_float32* result)
+{
+	return ReplaySample (Call::GetSampleFloat32, sessionId, sampleId, counterIndex, result, true);
+}
+
+GPA_Status ReplayGetSampleFloat64 (gpa_uint32 sessionId, gpa_uint32 sampleId,
+	gpa_uint32 counterIndex, gpa_float64* result)
+{
+	return ReplaySample (Call::GetSampleFloat64, sessionId, sampleId, counterIndex, result, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CheckNoLogActive ()
+{
+	if (recorder != nullptr || replayer != nullptr) {
+		NIV_THROW (std::runtime_error ("A GPA call recording or replay is already active."));
+	}
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BeginRecording (ImportTable& table, const std::string& filename,
+	const ProfileApi::Enum api)
+{
+	CheckNoLogActive ();
+
+	std::unique_ptr<Recorder> r (new Recorder);
+	r->log.Open (filename, api);
+
+	r->original = table;
+	recorder = r.release ();
+
+	table.initialize			= RecordInitialize;
+	table.destroy				= RecordDestroy;
+	table.openContext			= RecordOpenContext;
+	table.selectContext			= RecordSelectContext;
+	table.closeContext			= RecordCloseContext;
+	table.getNumCounters		= RecordGetNumCounters;
+	table.getCounterName		= RecordGetCounterName;
+	table.getCounterDataType	= RecordGetCounterDataType;
+	table.getCounterUsageType	= RecordGetCounterUsageType;
+	table.enableCounter			= RecordEnableCounter;
+	table.disableCounter		= RecordDisableCounter;
+	table.getPassCount			= RecordGetPassCount;
+	table.beginSession			= RecordBeginSession;
+	table.endSession			= RecordEndSession;
+	table.beginPass				= RecordBeginPass;
+	table.endPass				= RecordEndPass;
+	table.beginSample			= RecordBeginSample;
+	table.endSample				= RecordEndSample;
+	table.getEnabledCount		= RecordGetEnabledCount;
+	table.getEnabledIndex		= RecordGetEnabledIndex;
+	table.isSessionReady		= RecordIsSessionReady;
+	table.getSampleUInt64		= RecordGetSampleUInt64;
+	table.getSampleUInt32		= RecordGetSampleUInt32;
+	table.getSampleFloat32		= RecordGetSampleFloat32;
+	table.getSampleFloat64		= RecordGetSampleFloat64;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void EndRecording (ImportTable& table)
+{
+	if (recorder == nullptr) {
+		return;
+	}
+
+	recorder->log.Flush ();
+
+	// Only restore the functions, the listener and the error log may have
+	// changed since
+	SessionListener* listener = table.listener;
+	const ErrorLog errors = table.errors;
+	table = recorder->original;
+	table.listener = listener;
+	table.errors = errors;
+
+	delete recorder;
+	recorder = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BeginReplay (ImportTable& table, const std::string& filename,
+	const ProfileApi::Enum api)
+{
+	CheckNoLogActive ();
+
+	std::unique_ptr<LogReader> r (new LogReader);
+	r->Open (filename, api);
+
+	replayer = r.release ();
+
+	table.initialize			= ReplayInitialize;
+	table.destroy				= ReplayDestroy;
+	table.openContext			= ReplayOpenContext;
+	table.selectContext			= ReplaySelectContext;
+	table.closeContext			= ReplayCloseContext;
+	table.getNumCounters		= ReplayGetNumCounters;
+	table.getCounterName		= ReplayGetCounterName;
+	table.getCounterDataType	= ReplayGetCounterDataType;
+	table.getCounterUsageType	= ReplayGetCounterUsageType;
+	table.enableCounter			= ReplayEnableCounter;
+	table.disableCounter		= ReplayDisableCounter;
+	table.getPassCount			= ReplayGetPassCount;
+	table.beginSession			= ReplayBeginSession;
+	table.endSession			= ReplayEndSession;
+	table.beginPass				= ReplayBeginPass;
+	table.endPass				= ReplayEndPass;
+	table.beginSample			= ReplayBeginSample;
+	table.endSample				= ReplayEndSample;
+	table.getEnabledCount		= ReplayGetEnabledCount;
+	table.getEnabledIndex		= ReplayGetEnabledIndex;
+	table.isSessionReady		= ReplayIsSessionReady;
+	table.getSampleUInt64		= ReplayGetSampleUInt64;
+	table.getSampleUInt32		= ReplayGetSampleUInt32;
+	table.getSampleFloat32		= ReplayGetSampleFloat32;
+	table.getSampleFloat64		= ReplayGetSampleFloat64;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void EndReplay (ImportTable&)
+{
+	delete replayer;
+	replayer = nullptr;
+}
+}
+}
@@ -0,0 +1,38 @@
+#ifndef NIV_AMD_PERF_LIB_CALLLOG_H_260076C2_AAAC_4CF4_A2A0_26824AA951A2
+#define NIV_AMD_PERF_LIB_CALLLOG_H_260076C2_AAAC_4CF4_A2A0_26824AA951A2
+
+#include "ImportTable.h"
+
+namespace Amd {
+namespace Internal {
+/**
+Replace all functions in table with ones which forward to the original
+functions and append each call, including arguments, status and returned
+values, to the log file.
+
+Only one recording or replay can be active at a time.
+*/
+void BeginRecording (ImportTable& table, const std::string& filename,
+	const ProfileApi::Enum api);
+
+/**
+Flush the log and restore the original functions.
+*/
+void EndRecording (ImportTable& table);
+
+/**
+Fill table with functions which serve the calls stored in the log file,
+without calling into GPUPerfAPI.
+
+Calls have to arrive in the recorded order with the recorded arguments,
+otherwise they fail with GPA_STATUS_ERROR_FAILED. The number of
+GPA_IsSessionReady calls may differ, as it depends on timing.
+*/
+void BeginReplay (ImportTable& table, const std::string& filename,
+	const ProfileApi::Enum api);
+
+void EndReplay (ImportTable& table);
+}
+}
+
+#endif
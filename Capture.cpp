@@ -0,0 +1,500 @@
+#include "Capture.h"
+
+#if AMD_PERF_API_LINUX
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#elif AMD_PERF_API_WINDOWS
+	#include <windows.h>
+#endif
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+namespace Amd {
+namespace {
+// Layout of a capture, all values little endian:
+//
+// Header:	"APLC", u32 version, u64 record offset, string build,
+//			u32 counter count, { string name, u8 data type, u8 usage } * count,
+//			zero padding up to the record offset
+// Records:	{ u64 frame, u32 scope, u32 counter, u64 value } * record count
+// Trailer:	u32 scope count, { u32 scope, string name } * count,
+//			u64 record count, u64 trailer offset, "APLE"
+//
+// Strings are stored as u32 length followed by the characters. The trailer is
+// only present if the capture was closed properly, without it, all data up to
+// the end of the file is treated as records.
+const char			HeaderMagic [4] = { 'A', 'P', 'L', 'C' };
+const char			TrailerMagic [4] = { 'A', 'P', 'L', 'E' };
+const std::uint32_t	CaptureVersion = 1;
+const std::size_t	RecordSize = 24;
+const std::size_t	TrailerFooterSize = 20;
+
+template <typename T>
+void Append (std::string& out, const T value)
+{
+	char bytes [sizeof (T)];
+	::memcpy (bytes, &value, sizeof (T));
+	out.append (bytes, sizeof (T));
+}
+
+void AppendString (std::string& out, const std::string& value)
+{
+	Append (out, static_cast<std::uint32_t> (value.size ()));
+	out += value;
+}
+
+class Parser
+{
+public:
+	Parser (const char* data, const std::size_t size, const std::size_t offset)
+	: data_ (data)
+	, size_ (size)
+	, offset_ (offset)
+	{
+	}
+
+	template <typename T>
+	T Read ()
+	{
+		Check (sizeof (T));
+		T result;
+		::memcpy (&result, data_ + offset_, sizeof (T));
+		offset_ += sizeof (T);
+		return result;
+	}
+
+	std::string ReadString ()
+	{
+		const auto length = Read<std::uint32_t> ();
+		Check (length);
+		std::string result (data_ + offset_, length);
+		offset_ += length;
+		return result;
+	}
+
+private:
+	void Check (const std::size_t bytes) const
+	{
+		if (offset_ + bytes > size_ || offset_ + bytes < offset_) {
+			throw std::runtime_error ("Capture file is corrupt.");
+		}
+	}
+
+	const char*	data_;
+	std::size_t	size_;
+	std::size_t	offset_;
+};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint64_t EncodeCaptureValue (const ResultEntry& entry)
+{
+	std::uint64_t result = 0;
+
+	switch (entry.dataType) {
+	case DataType::float32:	::memcpy (&result, &entry.f32, sizeof (entry.f32)); break;
+	case DataType::float64:	::memcpy (&result, &entry.f64, sizeof (entry.f64)); break;
+	case DataType::uint32:	result = entry.u32; break;
+	case DataType::uint64:	result = entry.u64; break;
+	case DataType::int32:	result = static_cast<std::uint32_t> (entry.i32); break;
+	case DataType::int64:	result = static_cast<std::uint64_t> (entry.i64); break;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CaptureWriter::CaptureWriter (const std::string& filename,
+	const CounterSet& counters, const std::string& build)
+: recordCount_ (0)
+{
+	file_.open (filename, std::ios::binary | std::ios::trunc);
+
+	if (!file_) {
+		throw std::runtime_error ("Could not open capture file: " + filename);
+	}
+
+	std::string catalogue;
+	std::uint32_t counterCount = 0;
+
+	for (const auto& kv : counters) {
+		AppendString (catalogue, kv.first);
+		Append (catalogue, static_cast<std::uint8_t> (kv.second.type));
+		Append (catalogue, static_cast<std::uint8_t> (kv.second.usage));
+
+		counterNames_.push_back (kv.first);
+		++counterCount;
+	}
+
+	std::string header (HeaderMagic, sizeof (HeaderMagic));
+	Append (header, CaptureVersion);
+
+	const auto recordOffsetPosition = header.size ();
+	Append (header, std::uint64_t (0));
+	AppendString (header, build);
+	Append (header, counterCount);
+	header += catalogue;
+
+	// Keep records 8-byte aligned
+	header.resize ((header.size () + 7) & ~std::size_t (7), '\0');
+
+	const std::uint64_t recordOffset = header.size ();
+	::memcpy (&header [recordOffsetPosition], &recordOffset, sizeof (recordOffset));
+
+	file_.write (header.data (), header.size ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CaptureWriter::~CaptureWriter ()
+{
+	if (file_.is_open ()) {
+		Close ();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureWriter::SetScopeName (const std::uint32_t scope, const std::string& name)
+{
+	scopeNames_ [scope] = name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureWriter::Write (const std::uint64_t frame, const std::uint32_t scope,
+	const SessionResult& result)
+{
+	WriteResult (frame, scope, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureWriter::Write (const std::uint64_t frame, const std::uint32_t scope,
+	const FrameResult& result)
+{
+	WriteResult (frame, scope, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <typename Result>
+void CaptureWriter::WriteResult (const std::uint64_t frame, const std::uint32_t scope,
+	const Result& result)
+{
+	CaptureRecord record;
+	record.frame = frame;
+	record.scope = scope;
+
+	for (const auto& kv : result) {
+		// The catalogue is written in the order of the counter set, which is
+		// sorted by name
+		const char* name = kv.first.c_str ();
+		auto it = std::lower_bound (counterNames_.begin (), counterNames_.end (), name,
+			[] (const std::string& a, const char* b) { return a.compare (b) < 0; });
+
+		if (it == counterNames_.end () || it->compare (name) != 0) {
+			throw std::runtime_error (std::string ("Counter not in capture catalogue: ") + name);
+		}
+
+		record.counter = static_cast<std::uint32_t> (it - counterNames_.begin ());
+		record.value = EncodeCaptureValue (kv.second);
+
+		Write (record);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureWriter::Write (const CaptureRecord& record)
+{
+	char bytes [RecordSize];
+
+	::memcpy (bytes, &record.frame, 8);
+	::memcpy (bytes + 8, &record.scope, 4);
+	::memcpy (bytes + 12, &record.counter, 4);
+	::memcpy (bytes + 16, &record.value, 8);
+
+	file_.write (bytes, RecordSize);
+	++recordCount_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureWriter::Close ()
+{
+	const std::uint64_t trailerOffset = static_cast<std::uint64_t> (file_.tellp ());
+
+	std::string trailer;
+	Append (trailer, static_cast<std::uint32_t> (scopeNames_.size ()));
+
+	for (const auto& kv : scopeNames_) {
+		Append (trailer, kv.first);
+		AppendString (trailer, kv.second);
+	}
+
+	Append (trailer, recordCount_);
+	Append (trailer, trailerOffset);
+	trailer.append (TrailerMagic, sizeof (TrailerMagic));
+
+	file_.write (trailer.data (), trailer.size ());
+	file_.close ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CaptureReader::CaptureReader (const std::string& filename)
+: data_ (nullptr)
+, size_ (0)
+, mapping_ (nullptr)
+, recordOffset_ (0)
+, recordCount_ (0)
+, closed_ (false)
+{
+	Map (filename);
+
+	try {
+		Parse (filename);
+	} catch (...) {
+		Unmap ();
+		throw;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CaptureReader::~CaptureReader ()
+{
+	Unmap ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureReader::Map (const std::string& filename)
+{
+#if AMD_PERF_API_LINUX
+	const int file = ::open (filename.c_str (), O_RDONLY);
+
+	if (file < 0) {
+		throw std::runtime_error ("Could not open capture file: " + filename);
+	}
+
+	struct stat info;
+
+	if (::fstat (file, &info) != 0
+		|| static_cast<std::uint64_t> (info.st_size) > std::numeric_limits<std::size_t>::max ()) {
+		::close (file);
+		throw std::runtime_error ("Could not open capture file: " + filename);
+	}
+
+	size_ = static_cast<std::size_t> (info.st_size);
+
+	if (size_ > 0) {
+		void* data = ::mmap (nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (data == MAP_FAILED) {
+			::close (file);
+			throw std::runtime_error ("Could not map capture file: " + filename);
+		}
+
+		// Records are mostly scanned front to back
+		::madvise (data, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*> (data);
+	}
+
+	// The mapping stays valid after closing the file
+	::close (file);
+#elif AMD_PERF_API_WINDOWS
+	HANDLE file = ::CreateFileA (filename.c_str (), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error ("Could not open capture file: " + filename);
+	}
+
+	LARGE_INTEGER size;
+
+	if (!::GetFileSizeEx (file, &size)
+		|| static_cast<std::uint64_t> (size.QuadPart) > std::numeric_limits<std::size_t>::max ()) {
+		::CloseHandle (file);
+		throw std::runtime_error ("Could not open capture file: " + filename);
+	}
+
+	size_ = static_cast<std::size_t> (size.QuadPart);
+
+	if (size_ > 0) {
+		HANDLE mapping = ::CreateFileMappingA (file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void* data = mapping ? ::MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+		if (data == nullptr) {
+			if (mapping) {
+				::CloseHandle (mapping);
+			}
+
+			::CloseHandle (file);
+			throw std::runtime_error ("Could not map capture file: " + filename);
+		}
+
+		mapping_ = mapping;
+		data_ = static_cast<const char*> (data);
+	}
+
+	::CloseHandle (file);
+#else
+#error "Unsupported platform"
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureReader::Unmap ()
+{
+	if (data_ == nullptr) {
+		return;
+	}
+
+#if AMD_PERF_API_LINUX
+	::munmap (const_cast<char*> (data_), size_);
+#elif AMD_PERF_API_WINDOWS
+	::UnmapViewOfFile (data_);
+	::CloseHandle (mapping_);
+#endif
+
+	data_ = nullptr;
+	mapping_ = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureReader::Parse (const std::string& filename)
+{
+	Parser header (data_, size_, 0);
+
+	if (size_ < sizeof (HeaderMagic)
+		|| ::memcmp (data_, HeaderMagic, sizeof (HeaderMagic)) != 0) {
+		throw std::runtime_error ("Not a capture file: " + filename);
+	}
+
+	header.Read<std::uint32_t> ();
+
+	if (header.Read<std::uint32_t> () != CaptureVersion) {
+		throw std::runtime_error ("Unsupported capture version: " + filename);
+	}
+
+	recordOffset_ = static_cast<std::size_t> (header.Read<std::uint64_t> ());
+	build_ = header.ReadString ();
+
+	const auto counterCount = header.Read<std::uint32_t> ();
+	counters_.reserve (counterCount);
+
+	for (std::uint32_t i = 0; i < counterCount; ++i) {
+		CaptureCounter counter;
+		counter.name = header.ReadString ();
+		counter.type = static_cast<DataType::Enum> (header.Read<std::uint8_t> ());
+		counter.usage = static_cast<UsageType::Enum> (header.Read<std::uint8_t> ());
+		counters_.push_back (counter);
+	}
+
+	if (recordOffset_ > size_) {
+		throw std::runtime_error ("Capture file is corrupt.");
+	}
+
+	std::size_t recordEnd = size_;
+
+	if (size_ >= recordOffset_ + TrailerFooterSize
+		&& ::memcmp (data_ + size_ - sizeof (TrailerMagic),
+			TrailerMagic, sizeof (TrailerMagic)) == 0) {
+		Parser footer (data_, size_, size_ - TrailerFooterSize);
+		footer.Read<std::uint64_t> ();
+		const auto trailerOffset = static_cast<std::size_t> (footer.Read<std::uint64_t> ());
+
+		// Records lie between the header and the trailer
+		if (trailerOffset < recordOffset_ || trailerOffset > size_) {
+			throw std::runtime_error ("Capture file is corrupt.");
+		}
+
+		Parser trailer (data_, size_, trailerOffset);
+		const auto scopeCount = trailer.Read<std::uint32_t> ();
+
+		for (std::uint32_t i = 0; i < scopeCount; ++i) {
+			const auto scope = trailer.Read<std::uint32_t> ();
+			scopeNames_ [scope] = trailer.ReadString ();
+		}
+
+		recordEnd = trailerOffset;
+		closed_ = true;
+	}
+
+	// A capture which was not closed may end with a partially written record
+	recordCount_ = (recordEnd - recordOffset_) / RecordSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const std::string& CaptureReader::GetBuild () const
+{
+	return build_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const std::vector<CaptureCounter>& CaptureReader::GetCounters () const
+{
+	return counters_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string CaptureReader::GetScopeName (const std::uint32_t scope) const
+{
+	auto it = scopeNames_.find (scope);
+
+	if (it == scopeNames_.end ()) {
+		return "#" + std::to_string (scope);
+	} else {
+		return it->second;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CaptureReader::IsClosed () const
+{
+	return closed_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CaptureReader::GetRecordCount () const
+{
+	return recordCount_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CaptureRecord CaptureReader::GetRecord (const std::size_t index) const
+{
+	if (index >= recordCount_) {
+		throw std::runtime_error ("Capture record index out of range.");
+	}
+
+	const char* p = data_ + recordOffset_ + index * RecordSize;
+
+	CaptureRecord record;
+	::memcpy (&record.frame, p, 8);
+	::memcpy (&record.scope, p + 8, 4);
+	::memcpy (&record.counter, p + 12, 4);
+	::memcpy (&record.value, p + 16, 8);
+
+	return record;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double CaptureReader::GetValue (const CaptureRecord& record) const
+{
+	if (record.counter >= counters_.size ()) {
+		throw std::runtime_error ("Capture file is corrupt.");
+	}
+
+	ResultEntry entry;
+	entry.dataType = counters_ [record.counter].type;
+
+	switch (entry.dataType) {
+	case DataType::float32:	::memcpy (&entry.f32, &record.value, sizeof (entry.f32)); break;
+	case DataType::float64:	::memcpy (&entry.f64, &record.value, sizeof (entry.f64)); break;
+	case DataType::uint32:	entry.u32 = static_cast<std::uint32_t> (record.value); break;
+	case DataType::uint64:	entry.u64 = record.value; break;
+	case DataType::int32:	entry.i32 = static_cast<std::int32_t> (record.value); break;
+	case DataType::int64:	entry.i64 = static_cast<std::int64_t> (record.value); break;
+	}
+
+	return ToDouble (entry);
+}
+}
@@ -0,0 +1,133 @@
+#ifndef NIV_AMD_PERF_LIB_CAPTURE_H_79EA852F_73CE_4BF4_AE66_9048001272B4
+#define NIV_AMD_PERF_LIB_CAPTURE_H_79EA852F_73CE_4BF4_AE66_9048001272B4
+
+#include "PerfLib.h"
+
+#include <fstream>
+
+namespace Amd {
+struct CaptureCounter
+{
+	std::string		name;
+	DataType::Enum	type;
+	UsageType::Enum	usage;
+};
+
+/**
+One counter value of one scope in one frame. The value is stored as raw bits,
+use CaptureReader::GetValue to convert it.
+*/
+struct CaptureRecord
+{
+	std::uint64_t	frame;
+	std::uint32_t	scope;
+	std::uint32_t	counter;	///< Index into the capture's counter catalogue
+	std::uint64_t	value;
+};
+
+/**
+Raw bits of a value as stored in CaptureRecord::value.
+*/
+std::uint64_t EncodeCaptureValue (const ResultEntry& entry);
+
+/**
+Writes sample results to a capture file.
+
+A capture starts with a header containing the build label and the counter
+catalogue, followed by fixed-size records, so captures can be scanned without
+parsing. Scope names are written when the capture is closed.
+*/
+class CaptureWriter
+{
+public:
+	// Noncopyable
+	CaptureWriter (const CaptureWriter& other) = delete;
+	CaptureWriter& operator= (const CaptureWriter& other) = delete;
+
+	CaptureWriter (const std::string& filename, const CounterSet& counters,
+		const std::string& build);
+	~CaptureWriter ();
+
+	void SetScopeName (const std::uint32_t scope, const std::string& name);
+
+	/**
+	Write all values of result. Throws if result contains a counter which is
+	not part of the catalogue the capture was created with.
+	*/
+	void Write (const std::uint64_t frame, const std::uint32_t scope,
+		const SessionResult& result);
+	void Write (const std::uint64_t frame, const std::uint32_t scope,
+		const FrameResult& result);
+
+	/**
+	Write a single record. record.counter is the position of the counter in
+	the CounterSet the capture was created with, and record.value is encoded
+	using EncodeCaptureValue.
+	*/
+	void Write (const CaptureRecord& record);
+
+	void Close ();
+
+private:
+	template <typename Result>
+	void WriteResult (const std::uint64_t frame, const std::uint32_t scope,
+		const Result& result);
+
+	std::ofstream							file_;
+	std::vector<std::string>				counterNames_;	///< Sorted, by catalogue index
+	std::map<std::uint32_t, std::string>	scopeNames_;
+	std::uint64_t							recordCount_;
+};
+
+/**
+Reads a capture file by mapping it into memory. Opening only parses the
+header and the trailer, records are read from the mapping on access, so large
+captures can be scanned without loading them. GetRecord and GetValue may be
+called from several threads.
+*/
+class CaptureReader
+{
+public:
+	// Noncopyable
+	CaptureReader (const CaptureReader& other) = delete;
+	CaptureReader& operator= (const CaptureReader& other) = delete;
+
+	explicit CaptureReader (const std::string& filename);
+	~CaptureReader ();
+
+	const std::string& GetBuild () const;
+	const std::vector<CaptureCounter>& GetCounters () const;
+
+	/**
+	Returns the name set while writing, or "#<scope>" if there is none.
+	*/
+	std::string GetScopeName (const std::uint32_t scope) const;
+
+	/**
+	False if the capture was not closed, it then has no scope names.
+	*/
+	bool IsClosed () const;
+
+	std::size_t GetRecordCount () const;
+	CaptureRecord GetRecord (const std::size_t index) const;
+
+	double GetValue (const CaptureRecord& record) const;
+
+private:
+	void Map (const std::string& filename);
+	void Parse (const std::string& filename);
+	void Unmap ();
+
+	const char*								data_;
+	std::size_t								size_;
+	void*									mapping_;	///< Mapping handle on Windows
+	std::string								build_;
+	std::vector<CaptureCounter>				counters_;
+	std::map<std::uint32_t, std::string>	scopeNames_;
+	std::size_t								recordOffset_;
+	std::size_t								recordCount_;
+	bool									closed_;
+};
+}
+
+#endif
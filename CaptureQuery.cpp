@@ -0,0 +1,160 @@
+#include "CaptureQuery.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Amd {
+namespace {
+// Keeps the bucket index of all finite doubles positive
+const std::int64_t BucketOffset = 100000;
+
+////////////////////////////////////////////////////////////////////////////////
+double GetBucketBase ()
+{
+	return std::log (1.01);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Contains (const std::vector<std::string>& values, const std::string& value)
+{
+	return std::find (values.begin (), values.end (), value) != values.end ();
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Histogram::Add (const double value)
+{
+	++buckets_ [GetBucket (value)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Histogram::Merge (const Histogram& other)
+{
+	for (const auto& kv : other.buckets_) {
+		buckets_ [kv.first] += kv.second;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Histogram::GetPercentile (const double p, const std::uint64_t count) const
+{
+	std::vector<std::pair<std::int64_t, std::uint64_t>> sorted (
+		buckets_.begin (), buckets_.end ());
+	std::sort (sorted.begin (), sorted.end ());
+
+	const double rank = p / 100 * static_cast<double> (count);
+	std::uint64_t seen = 0;
+
+	for (const auto& bucket : sorted) {
+		seen += bucket.second;
+
+		if (static_cast<double> (seen) >= rank) {
+			return GetValue (bucket.first);
+		}
+	}
+
+	return sorted.empty () ? 0 : GetValue (sorted.back ().first);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::int64_t Histogram::GetBucket (const double value)
+{
+	if (value == 0) {
+		return 0;
+	}
+
+	const auto bucket = static_cast<std::int64_t> (
+		std::floor (std::log (std::abs (value)) / GetBucketBase ())) + BucketOffset;
+
+	return value < 0 ? -bucket : bucket;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Histogram::GetValue (const std::int64_t bucket)
+{
+	if (bucket == 0) {
+		return 0;
+	}
+
+	// Geometric center of the bucket
+	const double magnitude = std::exp (
+		(static_cast<double> (std::abs (bucket) - BucketOffset) + 0.5) * GetBucketBase ());
+
+	return bucket < 0 ? -magnitude : magnitude;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+QueryAggregate::QueryAggregate ()
+: count (0)
+, sum (0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QueryAggregate::Merge (const QueryAggregate& other)
+{
+	count += other.count;
+	sum += other.sum;
+	histogram.Merge (other.histogram);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<bool> SelectCounters (const CaptureReader& reader, const QueryFilter& filter)
+{
+	const auto& counters = reader.GetCounters ();
+	std::vector<bool> result (counters.size ());
+
+	for (std::size_t i = 0; i < counters.size (); ++i) {
+		result [i] = filter.counters.empty () || Contains (filter.counters, counters [i].name);
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ScanCapture (const CaptureReader& reader, const std::vector<bool>& counters,
+	const std::size_t begin, const std::size_t end, const QueryFilter& filter,
+	QueryAggregates& aggregates)
+{
+	// Scope and catalogue index to the group, or null if the scope is filtered
+	std::unordered_map<std::uint64_t, QueryAggregate*> groups;
+
+	for (std::size_t i = begin; i < end; ++i) {
+		const auto record = reader.GetRecord (i);
+
+		if (record.frame < filter.firstFrame || record.frame > filter.lastFrame
+			|| record.counter >= counters.size () || !counters [record.counter]) {
+			continue;
+		}
+
+		const auto id = (static_cast<std::uint64_t> (record.scope) << 32) | record.counter;
+		auto it = groups.find (id);
+
+		if (it == groups.end ()) {
+			const auto scope = reader.GetScopeName (record.scope);
+			QueryAggregate* group = nullptr;
+
+			if (filter.scopes.empty () || Contains (filter.scopes, scope)) {
+				group = &aggregates [QueryKey (reader.GetBuild (), scope,
+					reader.GetCounters () [record.counter].name)];
+			}
+
+			it = groups.emplace (id, group).first;
+		}
+
+		if (it->second == nullptr) {
+			continue;
+		}
+
+		const double value = reader.GetValue (record);
+
+		if (!std::isfinite (value)) {
+			continue;
+		}
+
+		it->second->count++;
+		it->second->sum += value;
+		it->second->histogram.Add (value);
+	}
+}
+}
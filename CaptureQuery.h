@@ -0,0 +1,84 @@
+#ifndef NIV_AMD_PERF_LIB_CAPTUREQUERY_H_C5ACE7C5_760D_492F_A9FE_14DABDD1A9E5
+#define NIV_AMD_PERF_LIB_CAPTUREQUERY_H_C5ACE7C5_760D_492F_A9FE_14DABDD1A9E5
+
+#include "Capture.h"
+
+#include <tuple>
+#include <unordered_map>
+
+namespace Amd {
+/**
+Histogram over logarithmic buckets, each 1% wide. Negative values are
+mirrored, zero has a bucket of its own.
+*/
+class Histogram
+{
+public:
+	void Add (const double value);
+	void Merge (const Histogram& other);
+
+	/**
+	p in [0, 100], count is the number of values added. Returns the geometric
+	center of the bucket containing the value of rank p/100 * count, or 0 if
+	the histogram is empty.
+	*/
+	double GetPercentile (const double p, const std::uint64_t count) const;
+
+private:
+	static std::int64_t GetBucket (const double value);
+	static double GetValue (const std::int64_t bucket);
+
+	std::unordered_map<std::int64_t, std::uint64_t>	buckets_;
+};
+
+struct QueryAggregate
+{
+	QueryAggregate ();
+
+	void Merge (const QueryAggregate& other);
+
+	std::uint64_t	count;
+	double			sum;
+	Histogram		histogram;
+};
+
+/**
+Build, scope name, counter name.
+*/
+typedef std::tuple<std::string, std::string, std::string> QueryKey;
+typedef std::map<QueryKey, QueryAggregate> QueryAggregates;
+
+/**
+Records to aggregate. Empty scopes or counters select all of them; frames
+are selected within [firstFrame, lastFrame].
+*/
+struct QueryFilter
+{
+	QueryFilter ()
+	: firstFrame (0)
+	, lastFrame (~std::uint64_t (0))
+	{
+	}
+
+	std::vector<std::string>	scopes;
+	std::vector<std::string>	counters;
+	std::uint64_t				firstFrame;
+	std::uint64_t				lastFrame;
+};
+
+/**
+Counters of the capture selected by filter, by catalogue index.
+*/
+std::vector<bool> SelectCounters (const CaptureReader& reader, const QueryFilter& filter);
+
+/**
+Add the finite values of the records [begin, end) which pass filter to the
+group of their build, scope and counter. counters is the result of
+SelectCounters for reader; filter.counters is not consulted again.
+*/
+void ScanCapture (const CaptureReader& reader, const std::vector<bool>& counters,
+	const std::size_t begin, const std::size_t end, const QueryFilter& filter,
+	QueryAggregates& aggregates);
+}
+
+#endif
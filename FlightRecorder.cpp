@@ -0,0 +1,358 @@
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace Amd {
+namespace {
+/**
+Values of one frame, as absolute positions in the value ring.
+*/
+struct FrameEntry
+{
+	std::uint64_t	frame;
+	std::uint64_t	begin;
+	std::uint64_t	end;
+};
+}
+
+struct FlightRecorder::Impl
+{
+	Impl (const std::string& prefix, const CounterSet& counters,
+		const std::string& build, const FlightRecorderConfig& config)
+	: prefix_ (prefix)
+	, counters_ (counters)
+	, build_ (build)
+	, postTriggerFrames_ (config.postTriggerFrames)
+	, frames_ (std::max<std::size_t> (1, config.frames))
+	, frameHead_ (0)
+	, frameCount_ (0)
+	, written_ (0)
+	, triggered_ (false)
+	, triggerFrame_ (0)
+	, dumpSize_ (0)
+	, dumpPending_ (false)
+	, dumpCount_ (0)
+	, droppedCount_ (0)
+	, stop_ (false)
+	{
+		std::uint32_t counterCount = 0;
+
+		// Same order as the catalogue written by CaptureWriter
+		for (const auto& kv : counters_) {
+			counterIndices_ [kv.first] = counterCount++;
+		}
+
+		const std::size_t valuesPerFrame = config.valuesPerFrame > 0
+			? config.valuesPerFrame : std::max<std::size_t> (1, counterCount);
+
+		values_.resize (frames_.size () * valuesPerFrame);
+		dump_.resize (values_.size ());
+
+		thread_ = std::thread (&Impl::Run, this);
+	}
+
+	~Impl ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			stop_ = true;
+		}
+
+		wake_.notify_all ();
+		thread_.join ();
+	}
+
+	void Record (const std::uint64_t frame, const std::uint32_t scope,
+		const SessionResult& result)
+	{
+		// Take the dump once all scopes of the last frame have arrived
+		if (triggered_ && frame > triggerFrame_ + postTriggerFrames_) {
+			Snapshot ();
+		}
+
+		if (frameCount_ == 0 || frames_ [frameHead_].frame != frame) {
+			BeginFrame (frame);
+		}
+
+		CaptureRecord record;
+		record.frame = frame;
+		record.scope = scope;
+
+		for (const auto& kv : result) {
+			auto it = counterIndices_.find (kv.first);
+
+			if (it == counterIndices_.end ()) {
+				continue;
+			}
+
+			record.counter = it->second;
+			record.value = EncodeCaptureValue (kv.second);
+
+			// The window is defined in frames, so values are never
+			// overwritten while their frame is part of it
+			if (written_ - GetOldestFrame ().begin >= values_.size ()) {
+				Grow ();
+			}
+
+			values_ [written_ % values_.size ()] = record;
+			frames_ [frameHead_].end = ++written_;
+		}
+
+		if (!triggered_ && trigger_ && trigger_ (scope, result)) {
+			triggered_ = true;
+			triggerFrame_ = frame;
+		}
+	}
+
+	void BeginFrame (const std::uint64_t frame)
+	{
+		if (frameCount_ > 0) {
+			frameHead_ = (frameHead_ + 1) % frames_.size ();
+		}
+
+		frameCount_ = std::min (frameCount_ + 1, frames_.size ());
+
+		FrameEntry& entry = frames_ [frameHead_];
+		entry.frame = frame;
+		entry.begin = written_;
+		entry.end = written_;
+	}
+
+	const FrameEntry& GetOldestFrame () const
+	{
+		return frames_ [(frameHead_ + 1 + frames_.size () - frameCount_) % frames_.size ()];
+	}
+
+	/**
+	Double the value ring, for frames with more values than estimated.
+	*/
+	void Grow ()
+	{
+		std::vector<CaptureRecord> values (values_.size () * 2);
+
+		for (std::uint64_t i = GetOldestFrame ().begin; i < written_; ++i) {
+			values [i % values.size ()] = values_ [i % values_.size ()];
+		}
+
+		values_.swap (values);
+	}
+
+	/**
+	Copy the window into the dump buffer and wake the writer.
+	*/
+	void Snapshot ()
+	{
+		triggered_ = false;
+
+		std::unique_lock<std::mutex> lock (mutex_);
+
+		if (dumpPending_) {
+			++droppedCount_;
+			return;
+		}
+
+		// Only the writer thread reads the dump buffer, while a dump is pending
+		if (dump_.size () < values_.size ()) {
+			dump_.resize (values_.size ());
+		}
+
+		dumpSize_ = 0;
+
+		if (frameCount_ > 0) {
+			for (std::uint64_t i = GetOldestFrame ().begin; i < written_; ++i) {
+				dump_ [dumpSize_++] = values_ [i % values_.size ()];
+			}
+		}
+
+		dumpPending_ = true;
+
+		lock.unlock ();
+		wake_.notify_all ();
+	}
+
+	void Flush ()
+	{
+		if (triggered_) {
+			Snapshot ();
+		}
+
+		std::unique_lock<std::mutex> lock (mutex_);
+		done_.wait (lock, [this] () { return !dumpPending_; });
+
+		if (error_) {
+			auto error = error_;
+			error_ = nullptr;
+			std::rethrow_exception (error);
+		}
+	}
+
+	void Run ()
+	{
+		std::unique_lock<std::mutex> lock (mutex_);
+
+		for (;;) {
+			wake_.wait (lock, [this] () { return dumpPending_ || stop_; });
+
+			if (dumpPending_) {
+				const auto filename = prefix_ + std::to_string (dumpCount_) + ".aplc";
+				const auto scopeNames = scopeNames_;
+
+				// The dump buffer is not touched while a dump is pending
+				lock.unlock ();
+
+				std::exception_ptr error;
+
+				try {
+					CaptureWriter writer (filename, counters_, build_);
+
+					for (const auto& kv : scopeNames) {
+						writer.SetScopeName (kv.first, kv.second);
+					}
+
+					for (std::size_t i = 0; i < dumpSize_; ++i) {
+						writer.Write (dump_ [i]);
+					}
+
+					writer.Close ();
+				} catch (...) {
+					error = std::current_exception ();
+				}
+
+				lock.lock ();
+
+				if (error && !error_) {
+					error_ = error;
+				}
+
+				++dumpCount_;
+				dumpPending_ = false;
+				done_.notify_all ();
+			} else if (stop_) {
+				return;
+			}
+		}
+	}
+
+	std::string								prefix_;
+	CounterSet								counters_;
+	std::string								build_;
+	std::map<std::string, std::uint32_t>	counterIndices_;
+	Trigger									trigger_;
+
+	std::size_t								postTriggerFrames_;
+	std::vector<FrameEntry>					frames_;		///< Ring of the frames in the window
+	std::size_t								frameHead_;		///< Newest frame
+	std::size_t								frameCount_;
+	std::vector<CaptureRecord>				values_;		///< Ring of the values of all frames
+	std::uint64_t							written_;		///< Values written in total
+	bool									triggered_;
+	std::uint64_t							triggerFrame_;
+
+	// Shared with the writer thread
+	std::mutex								mutex_;
+	std::condition_variable					wake_;
+	std::condition_variable					done_;
+	std::vector<CaptureRecord>				dump_;
+	std::size_t								dumpSize_;
+	bool									dumpPending_;
+	std::size_t								dumpCount_;
+	std::size_t								droppedCount_;
+	std::map<std::uint32_t, std::string>	scopeNames_;
+	std::exception_ptr						error_;
+	bool									stop_;
+	std::thread								thread_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+FlightRecorder::FlightRecorder (const std::string& prefix,
+	const CounterSet& counters, const std::string& build,
+	const FlightRecorderConfig& config)
+: impl_ (new Impl (prefix, counters, build, config))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FlightRecorder::~FlightRecorder ()
+{
+	// Write a pending dump, but don't throw from the destructor
+	try {
+		impl_->Flush ();
+	} catch (...) {
+	}
+
+	delete impl_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FlightRecorder::SetTrigger (const Trigger& trigger)
+{
+	impl_->trigger_ = trigger;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FlightRecorder::SetScopeName (const std::uint32_t scope, const std::string& name)
+{
+	std::lock_guard<std::mutex> lock (impl_->mutex_);
+	impl_->scopeNames_ [scope] = name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FlightRecorder::Record (const std::uint64_t frame, const std::uint32_t scope,
+	const SessionResult& result)
+{
+	impl_->Record (frame, scope, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FlightRecorder::Dump ()
+{
+	impl_->Snapshot ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FlightRecorder::Flush ()
+{
+	impl_->Flush ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t FlightRecorder::GetDumpCount () const
+{
+	std::lock_guard<std::mutex> lock (impl_->mutex_);
+	return impl_->dumpCount_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t FlightRecorder::GetDroppedDumpCount () const
+{
+	std::lock_guard<std::mutex> lock (impl_->mutex_);
+	return impl_->droppedCount_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FlightRecorder::Trigger FlightRecorder::Above (const std::string& counter,
+	const double threshold)
+{
+	const std::string name = counter;
+
+	return [name, threshold] (const std::uint32_t, const SessionResult& result) {
+		auto it = result.find (name);
+		return it != result.end () && ToDouble (it->second) > threshold;
+	};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FlightRecorder::Trigger FlightRecorder::Outside (
+	const std::function<double (const SessionResult&)>& metric,
+	const double low, const double high)
+{
+	return [metric, low, high] (const std::uint32_t, const SessionResult& result) {
+		const double value = metric (result);
+		return value < low || value > high;
+	};
+}
+}
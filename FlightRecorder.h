@@ -0,0 +1,106 @@
+#ifndef NIV_AMD_PERF_LIB_FLIGHTRECORDER_H_3D8A2F17_6B4E_4C91_A0F5_E27C8B1D4A63
+#define NIV_AMD_PERF_LIB_FLIGHTRECORDER_H_3D8A2F17_6B4E_4C91_A0F5_E27C8B1D4A63
+
+#include "Capture.h"
+
+#include <functional>
+
+namespace Amd {
+/**
+frames is the number of frames kept and dumped, regardless of how many scopes
+each has. valuesPerFrame is the expected number of counter values per frame,
+over all scopes, used to preallocate the ring; it defaults to the number of
+counters, that is, one scope per frame. postTriggerFrames is the number of
+frames recorded after the trigger fired before the dump is taken.
+*/
+struct FlightRecorderConfig
+{
+	FlightRecorderConfig ()
+	: frames (300)
+	, valuesPerFrame (0)
+	, postTriggerFrames (0)
+	{
+	}
+
+	std::size_t	frames;
+	std::size_t	valuesPerFrame;
+	std::size_t	postTriggerFrames;
+};
+
+/**
+Keeps the results of the most recent frames in a preallocated ring, and
+writes them to a capture file when a trigger fires.
+
+Record only copies the values into the ring and evaluates the trigger; the
+capture is written on a background thread, to <prefix><n>.aplc, where n
+counts the dumps. If frames carry more values than preallocated, the ring
+grows, so Record allocates until the largest frames have been seen. While a
+dump is being written, further dumps are dropped and counted, see
+GetDroppedDumpCount. Record must be called from one thread only, with
+non-decreasing frame numbers.
+*/
+class FlightRecorder
+{
+public:
+	// Noncopyable
+	FlightRecorder (const FlightRecorder& other) = delete;
+	FlightRecorder& operator= (const FlightRecorder& other) = delete;
+
+	/**
+	Returns true if the window should be dumped. Called for every recorded
+	result.
+	*/
+	typedef std::function<bool (const std::uint32_t scope, const SessionResult& result)> Trigger;
+
+	FlightRecorder (const std::string& prefix, const CounterSet& counters,
+		const std::string& build,
+		const FlightRecorderConfig& config = FlightRecorderConfig ());
+	~FlightRecorder ();
+
+	void SetTrigger (const Trigger& trigger);
+	void SetScopeName (const std::uint32_t scope, const std::string& name);
+
+	/**
+	Counters in result which are not part of counters are ignored.
+	*/
+	void Record (const std::uint64_t frame, const std::uint32_t scope,
+		const SessionResult& result);
+
+	/**
+	Dump the current window, regardless of the trigger.
+	*/
+	void Dump ();
+
+	/**
+	Block until pending dumps have been written. Throws if writing a dump
+	failed.
+	*/
+	void Flush ();
+
+	std::size_t GetDumpCount () const;
+
+	/**
+	Number of dumps, triggered or requested with Dump, which were dropped
+	because the previous one was still being written.
+	*/
+	std::size_t GetDroppedDumpCount () const;
+
+	/**
+	Fires if counter is above threshold.
+	*/
+	static Trigger Above (const std::string& counter, const double threshold);
+
+	/**
+	Fires if metric is outside of [low, high]. metric may derive a value from
+	several counters.
+	*/
+	static Trigger Outside (const std::function<double (const SessionResult&)>& metric,
+		const double low, const double high);
+
+private:
+	struct Impl;
+	Impl*	impl_;
+};
+}
+
+#endif
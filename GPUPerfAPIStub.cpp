@@ -0,0 +1,438 @@
+// Stand-in for the GPUPerfAPI library, which needs no GPU. It is built with
+// the file name of the OpenCL GPUPerfAPI library, so it is picked up by
+// PerformanceLibrary (ProfileApi::OpenCL) when placed next to the executable.
+//
+// It exposes StubCounterCount counters. The first two are named GPUTime and
+// FetchSize, the remaining ones Counter<index>, with data types cycling through
+// all GPA types. Sessions are ready immediately, and sample values are derived
+// from the session, sample and counter index, so results are deterministic.
+// Tests can make the next call of a function fail with GPAStub_InjectFailure.
+
+#include "GPUPerfAPITypes.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define NIV_GPA_STUB_CHECK_INJECTED() do { \
+	GPA_Status injected_; \
+	if (TakeInjectedFailure (__func__, injected_)) return injected_; \
+	} while (0)
+
+#if AMD_PERF_API_WINDOWS
+	#define NIV_GPA_STUB_EXPORT extern "C" __declspec(dllexport)
+#else
+	#define NIV_GPA_STUB_EXPORT extern "C" __attribute__ ((visibility ("default")))
+#endif
+
+namespace {
+const gpa_uint32 StubCounterCount = 512;
+
+struct State
+{
+	State ()
+	: initialized (false)
+	, contextOpen (false)
+	, nextSessionId (1)
+	, sessionActive (false)
+	, passActive (false)
+	, sampleActive (false)
+	{
+	}
+
+	bool						initialized;
+	bool						contextOpen;
+	std::vector<std::string>	names;
+	std::vector<gpa_uint32>		enabled;	///< Sorted counter indices
+	gpa_uint32					nextSessionId;
+	bool						sessionActive;
+	bool						passActive;
+	bool						sampleActive;
+};
+
+State state;
+
+// Kept across GPA_Initialize and GPA_Destroy
+std::string	failingFunction;
+GPA_Status	failingStatus = GPA_STATUS_OK;
+
+bool TakeInjectedFailure (const char* function, GPA_Status& status)
+{
+	if (failingFunction != function) {
+		return false;
+	}
+
+	failingFunction.clear ();
+	status = failingStatus;
+	return true;
+}
+
+GPA_Type GetType (const gpa_uint32 index)
+{
+	static const GPA_Type types [] = {
+		GPA_TYPE_FLOAT64, GPA_TYPE_UINT64, GPA_TYPE_FLOAT32,
+		GPA_TYPE_UINT32, GPA_TYPE_INT32, GPA_TYPE_INT64
+	};
+
+	return types [index % (sizeof (types) / sizeof (types [0]))];
+}
+
+gpa_uint64 GetValue (const gpa_uint32 sessionId, const gpa_uint32 sampleId,
+	const gpa_uint32 counterIndex)
+{
+	return (static_cast<gpa_uint64> (sessionId) * 1000 + sampleId) * 1000 + counterIndex;
+}
+
+GPA_Status CheckCounter (const gpa_uint32 index)
+{
+	if (!state.contextOpen) {
+		return GPA_STATUS_ERROR_COUNTERS_NOT_OPEN;
+	}
+
+	return index < StubCounterCount ? GPA_STATUS_OK : GPA_STATUS_ERROR_INDEX_OUT_OF_RANGE;
+}
+
+GPA_Status CheckSample (const gpa_uint32 sessionId, const gpa_uint32 counterIndex,
+	const GPA_Type type)
+{
+	if (sessionId == 0 || sessionId >= state.nextSessionId) {
+		return GPA_STATUS_ERROR_SESSION_NOT_FOUND;
+	}
+
+	if (!std::binary_search (state.enabled.begin (), state.enabled.end (), counterIndex)) {
+		return GPA_STATUS_ERROR_NOT_ENABLED;
+	}
+
+	return GetType (counterIndex) == type ? GPA_STATUS_OK : GPA_STATUS_ERROR_COUNTER_NOT_OF_SPECIFIED_TYPE;
+}
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_Initialize ()
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (state.initialized) {
+		return GPA_STATUS_ERROR_FAILED;
+	}
+
+	state = State ();
+	state.initialized = true;
+
+	state.names.push_back ("GPUTime");
+	state.names.push_back ("FetchSize");
+
+	for (gpa_uint32 i = 2; i < StubCounterCount; ++i) {
+		state.names.push_back ("Counter" + std::to_string (i));
+	}
+
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_Destroy ()
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	state = State ();
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_OpenContext (void*)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (state.contextOpen) {
+		return GPA_STATUS_ERROR_COUNTERS_ALREADY_OPEN;
+	}
+
+	state.contextOpen = true;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_SelectContext (void*)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	return state.contextOpen ? GPA_STATUS_OK : GPA_STATUS_ERROR_COUNTERS_NOT_OPEN;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_CloseContext ()
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (!state.contextOpen) {
+		return GPA_STATUS_ERROR_COUNTERS_NOT_OPEN;
+	}
+
+	state.contextOpen = false;
+	state.enabled.clear ();
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetNumCounters (gpa_uint32* count)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (!state.contextOpen) {
+		return GPA_STATUS_ERROR_COUNTERS_NOT_OPEN;
+	}
+
+	*count = StubCounterCount;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetCounterName (gpa_uint32 index, const char** name)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	const auto status = CheckCounter (index);
+	if (status == GPA_STATUS_OK) {
+		*name = state.names [index].c_str ();
+	}
+	return status;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetCounterDataType (gpa_uint32 index, GPA_Type* type)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	const auto status = CheckCounter (index);
+	if (status == GPA_STATUS_OK) {
+		*type = GetType (index);
+	}
+	return status;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetCounterUsageType (gpa_uint32 index, GPA_Usage_Type* usage)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	const auto status = CheckCounter (index);
+	if (status == GPA_STATUS_OK) {
+		*usage = index == 0 ? GPA_USAGE_TYPE_MILLISECONDS : GPA_USAGE_TYPE_ITEMS;
+	}
+	return status;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_EnableCounter (gpa_uint32 index)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	const auto status = CheckCounter (index);
+	if (status != GPA_STATUS_OK) {
+		return status;
+	}
+
+	auto it = std::lower_bound (state.enabled.begin (), state.enabled.end (), index);
+	if (it != state.enabled.end () && *it == index) {
+		return GPA_STATUS_ERROR_ALREADY_ENABLED;
+	}
+
+	state.enabled.insert (it, index);
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_DisableCounter (gpa_uint32 index)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	const auto status = CheckCounter (index);
+	if (status != GPA_STATUS_OK) {
+		return status;
+	}
+
+	auto it = std::lower_bound (state.enabled.begin (), state.enabled.end (), index);
+	if (it == state.enabled.end () || *it != index) {
+		return GPA_STATUS_ERROR_NOT_ENABLED;
+	}
+
+	state.enabled.erase (it);
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetPassCount (gpa_uint32* count)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	// Pretend that 64 counters fit into a pass
+	*count = std::max<gpa_uint32> (1, static_cast<gpa_uint32> ((state.enabled.size () + 63) / 64));
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_BeginSession (gpa_uint32* sessionId)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (state.sessionActive) {
+		return GPA_STATUS_ERROR_SAMPLING_ALREADY_STARTED;
+	}
+
+	if (state.enabled.empty ()) {
+		return GPA_STATUS_ERROR_NO_COUNTERS_ENABLED;
+	}
+
+	state.sessionActive = true;
+	*sessionId = state.nextSessionId++;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_EndSession ()
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (!state.sessionActive) {
+		return GPA_STATUS_ERROR_SAMPLING_NOT_STARTED;
+	}
+
+	state.sessionActive = false;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_BeginPass ()
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (!state.sessionActive) {
+		return GPA_STATUS_ERROR_SAMPLING_NOT_STARTED;
+	}
+
+	if (state.passActive) {
+		return GPA_STATUS_ERROR_PASS_ALREADY_STARTED;
+	}
+
+	state.passActive = true;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_EndPass ()
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (!state.passActive) {
+		return GPA_STATUS_ERROR_PASS_NOT_STARTED;
+	}
+
+	state.passActive = false;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_BeginSample (gpa_uint32)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (!state.passActive) {
+		return GPA_STATUS_ERROR_PASS_NOT_STARTED;
+	}
+
+	if (state.sampleActive) {
+		return GPA_STATUS_ERROR_SAMPLE_ALREADY_STARTED;
+	}
+
+	state.sampleActive = true;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_EndSample ()
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (!state.sampleActive) {
+		return GPA_STATUS_ERROR_SAMPLE_NOT_STARTED;
+	}
+
+	state.sampleActive = false;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetEnabledCount (gpa_uint32* count)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	*count = static_cast<gpa_uint32> (state.enabled.size ());
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetEnabledIndex (gpa_uint32 enabledNumber, gpa_uint32* index)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (enabledNumber >= state.enabled.size ()) {
+		return GPA_STATUS_ERROR_INDEX_OUT_OF_RANGE;
+	}
+
+	*index = state.enabled [enabledNumber];
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_IsSessionReady (bool* ready, gpa_uint32 sessionId)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	if (sessionId == 0 || sessionId >= state.nextSessionId) {
+		return GPA_STATUS_ERROR_SESSION_NOT_FOUND;
+	}
+
+	*ready = !state.sessionActive || sessionId + 1 < state.nextSessionId;
+	return GPA_STATUS_OK;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetSampleUInt64 (gpa_uint32 sessionId,
+	gpa_uint32 sampleId, gpa_uint32 counterIndex, gpa_uint64* result)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	auto status = CheckSample (sessionId, counterIndex, GPA_TYPE_UINT64);
+	if (status == GPA_STATUS_ERROR_COUNTER_NOT_OF_SPECIFIED_TYPE) {
+		// GPUPerfAPI reads signed counters using the unsigned functions
+		status = CheckSample (sessionId, counterIndex, GPA_TYPE_INT64);
+	}
+	if (status == GPA_STATUS_OK) {
+		*result = GetValue (sessionId, sampleId, counterIndex);
+	}
+	return status;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetSampleUInt32 (gpa_uint32 sessionId,
+	gpa_uint32 sampleId, gpa_uint32 counterIndex, gpa_uint32* result)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	auto status = CheckSample (sessionId, counterIndex, GPA_TYPE_UINT32);
+	if (status == GPA_STATUS_ERROR_COUNTER_NOT_OF_SPECIFIED_TYPE) {
+		status = CheckSample (sessionId, counterIndex, GPA_TYPE_INT32);
+	}
+	if (status == GPA_STATUS_OK) {
+		*result = static_cast<gpa_uint32> (GetValue (sessionId, sampleId, counterIndex));
+	}
+	return status;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetSampleFloat32 (gpa_uint32 sessionId,
+	gpa_uint32 sampleId, gpa_uint32 counterIndex, gpa_float32* result)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	const auto status = CheckSample (sessionId, counterIndex, GPA_TYPE_FLOAT32);
+	if (status == GPA_STATUS_OK) {
+		*result = static_cast<gpa_float32> (GetValue (sessionId, sampleId, counterIndex)) / 1000.0f;
+	}
+	return status;
+}
+
+NIV_GPA_STUB_EXPORT GPA_Status GPA_GetSampleFloat64 (gpa_uint32 sessionId,
+	gpa_uint32 sampleId, gpa_uint32 counterIndex, gpa_float64* result)
+{
+	NIV_GPA_STUB_CHECK_INJECTED ();
+
+	const auto status = CheckSample (sessionId, counterIndex, GPA_TYPE_FLOAT64);
+	if (status == GPA_STATUS_OK) {
+		*result = static_cast<gpa_float64> (GetValue (sessionId, sampleId, counterIndex)) / 1000.0;
+	}
+	return status;
+}
+
+// Make the next call of function, for instance "GPA_EndSample", fail with status
+NIV_GPA_STUB_EXPORT void GPAStub_InjectFailure (const char* function, GPA_Status status)
+{
+	failingFunction = function;
+	failingStatus = status;
+}
@@ -0,0 +1,106 @@
+#ifndef NIV_AMD_PERF_LIB_IMPORTTABLE_H_39C2F187_5653_4BD0_93AB_123FA9CF973A
+#define NIV_AMD_PERF_LIB_IMPORTTABLE_H_39C2F187_5653_4BD0_93AB_123FA9CF973A
+
+#include "PerfLib.h"
+#include "GPUPerfAPI.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined (__cpp_exceptions) || defined (__EXCEPTIONS) || defined (_CPPUNWIND)
+	#define NIV_THROW(e) throw e
+#else
+	// Errors which can only be reported by throwing terminate the process when
+	// exceptions are disabled, use the noexcept Try* functions instead
+	#define NIV_THROW(e) ::Amd::Internal::Abort (e)
+#endif
+
+#define NIV_SAFE_GPA(expr) do { const auto r = (expr); if (r != GPA_STATUS_OK) NIV_THROW (Exception (r)); } while (0)
+
+namespace Amd {
+namespace Internal {
+[[noreturn]] inline void Abort (const std::exception& e)
+{
+	::fprintf (stderr, "%s\n", e.what ());
+	::abort ();
+}
+
+struct ErrorLog
+{
+	enum
+	{
+		Capacity = 64
+	};
+
+	void Add (const int code, const char* operation) noexcept
+	{
+		if (count < Capacity) {
+			records [count].code = code;
+			records [count].operation = operation;
+			++count;
+		} else {
+			overflow = true;
+		}
+	}
+
+	ErrorRecord	records [Capacity];
+	std::size_t	count;
+	bool		overflow;
+};
+
+struct ImportTable
+{
+	GPA_InitializePtrType 			initialize;
+	GPA_DestroyPtrType 				destroy;
+
+	GPA_OpenContextPtrType			openContext;
+	GPA_SelectContextPtrType		selectContext;
+	GPA_CloseContextPtrType			closeContext;
+
+	GPA_GetNumCountersPtrType		getNumCounters;
+	GPA_GetCounterNamePtrType		getCounterName;
+	GPA_GetCounterDataTypePtrType	getCounterDataType;
+	GPA_GetCounterUsageTypePtrType  getCounterUsageType;
+
+	GPA_EnableCounterPtrType		enableCounter;
+	GPA_DisableCounterPtrType		disableCounter;
+
+	GPA_GetPassCountPtrType 		getPassCount;
+
+	GPA_BeginSessionPtrType 		beginSession;
+	GPA_EndSessionPtrType 			endSession;
+
+	GPA_BeginPassPtrType 			beginPass;
+	GPA_EndPassPtrType 				endPass;
+
+	GPA_BeginSamplePtrType 			beginSample;
+	GPA_EndSamplePtrType 			endSample;
+
+	GPA_GetEnabledCountPtrType		getEnabledCount;
+	GPA_GetEnabledIndexPtrType		getEnabledIndex;
+
+	GPA_IsSessionReadyPtrType 		isSessionReady;
+	GPA_GetSampleUInt64PtrType 		getSampleUInt64;
+	GPA_GetSampleUInt32PtrType 		getSampleUInt32;
+	GPA_GetSampleFloat32PtrType 	getSampleFloat32;
+	GPA_GetSampleFloat64PtrType 	getSampleFloat64;
+
+	SessionListener*				listener;
+	ErrorLog						errors;
+
+	/**
+	Log status if it is an error, and return it.
+	*/
+	int Check (const int status, const char* operation) noexcept
+	{
+		if (status != GPA_STATUS_OK) {
+			errors.Add (status, operation);
+		}
+
+		return status;
+	}
+};
+}
+}
+
+#endif
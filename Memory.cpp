@@ -0,0 +1,146 @@
+#include "Memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+namespace Amd {
+namespace {
+class NewDeleteResource : public MemoryResource
+{
+public:
+	void* Allocate (const std::size_t size, const std::size_t) override
+	{
+		return ::operator new (size);
+	}
+
+	void Deallocate (void* p, const std::size_t, const std::size_t) override
+	{
+		::operator delete (p);
+	}
+};
+
+NewDeleteResource newDeleteResource;
+std::atomic<MemoryResource*> defaultResource (&newDeleteResource);
+
+////////////////////////////////////////////////////////////////////////////////
+std::uintptr_t AlignUp (const std::uintptr_t p, const std::size_t alignment)
+{
+	return (p + alignment - 1) & ~static_cast<std::uintptr_t> (alignment - 1);
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryResource::~MemoryResource ()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryResource* GetDefaultResource () noexcept
+{
+	return defaultResource.load ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryResource* SetDefaultResource (MemoryResource* resource) noexcept
+{
+	return defaultResource.exchange (resource ? resource : &newDeleteResource);
+}
+
+struct FrameArena::Block
+{
+	Block*		next;
+	std::size_t	size;	///< Usable bytes following the header
+
+	char* GetData ()
+	{
+		return reinterpret_cast<char*> (this + 1);
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+FrameArena::FrameArena (const std::size_t blockSize, MemoryResource* upstream)
+: upstream_ (upstream)
+, blockSize_ (blockSize)
+, head_ (nullptr)
+, current_ (nullptr)
+, offset_ (0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FrameArena::~FrameArena ()
+{
+	while (head_) {
+		Block* next = head_->next;
+		upstream_->Deallocate (head_, sizeof (Block) + head_->size, alignof (Block));
+		head_ = next;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* FrameArena::Allocate (const std::size_t size, const std::size_t alignment)
+{
+	for (;;) {
+		if (current_) {
+			const auto base = reinterpret_cast<std::uintptr_t> (current_->GetData ());
+			const auto p = AlignUp (base + offset_, alignment);
+
+			if (p + size <= base + current_->size) {
+				offset_ = p + size - base;
+				return reinterpret_cast<void*> (p);
+			}
+		}
+
+		// Continue with the next block kept from previous frames, if the
+		// allocation fits
+		Block* next = current_ ? current_->next : head_;
+
+		if (next && next->size >= size + alignment) {
+			current_ = next;
+			offset_ = 0;
+			continue;
+		}
+
+		const auto blockSize = std::max (blockSize_, size + alignment);
+		Block* block = static_cast<Block*> (upstream_->Allocate (
+			sizeof (Block) + blockSize, alignof (Block)));
+		block->next = next;
+		block->size = blockSize;
+
+		if (current_) {
+			current_->next = block;
+		} else {
+			head_ = block;
+		}
+
+		current_ = block;
+		offset_ = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FrameArena::Deallocate (void*, const std::size_t, const std::size_t)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FrameArena::Reset ()
+{
+	current_ = head_;
+	offset_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t FrameArena::GetCapacity () const
+{
+	std::size_t result = 0;
+
+	for (Block* block = head_; block; block = block->next) {
+		result += block->size;
+	}
+
+	return result;
+}
+}
@@ -0,0 +1,151 @@
+#ifndef NIV_AMD_PERF_LIB_MEMORY_H_0B3E6A41_5C2D_4F8E_9D17_A4E2C9F81B36
+#define NIV_AMD_PERF_LIB_MEMORY_H_0B3E6A41_5C2D_4F8E_9D17_A4E2C9F81B36
+
+#include <cstddef>
+#include <string>
+
+namespace Amd {
+/**
+Source of memory for the wrapper's containers, see Allocator.
+*/
+class MemoryResource
+{
+public:
+	virtual ~MemoryResource ();
+
+	virtual void* Allocate (const std::size_t size, const std::size_t alignment) = 0;
+	virtual void Deallocate (void* p, const std::size_t size,
+		const std::size_t alignment) = 0;
+};
+
+/**
+The resource used by default-constructed allocators. Initially, this is a
+resource using operator new and delete.
+*/
+MemoryResource* GetDefaultResource () noexcept;
+
+/**
+Replace the default resource and return the previous one. Passing nullptr
+restores the initial resource. The resource must outlive all allocations
+made from it.
+*/
+MemoryResource* SetDefaultResource (MemoryResource* resource) noexcept;
+
+/**
+Bump allocator for per-frame data such as sample results.
+
+Memory is taken from the upstream resource in blocks, Deallocate does
+nothing. Reset releases all allocations at once and keeps the blocks for
+reuse, so after the first few frames, no more memory is requested from
+upstream. Not thread-safe.
+*/
+class FrameArena : public MemoryResource
+{
+public:
+	// Noncopyable
+	FrameArena (const FrameArena& other) = delete;
+	FrameArena& operator= (const FrameArena& other) = delete;
+
+	explicit FrameArena (const std::size_t blockSize = 64 * 1024,
+		MemoryResource* upstream = GetDefaultResource ());
+	~FrameArena ();
+
+	void* Allocate (const std::size_t size, const std::size_t alignment) override;
+	void Deallocate (void* p, const std::size_t size,
+		const std::size_t alignment) override;
+
+	/**
+	Release all allocations. Everything allocated from this arena must not be
+	used afterwards, including the containers holding it.
+	*/
+	void Reset ();
+
+	/**
+	Total size of the blocks taken from upstream.
+	*/
+	std::size_t GetCapacity () const;
+
+private:
+	struct Block;
+
+	MemoryResource*	upstream_;
+	std::size_t		blockSize_;
+	Block*			head_;
+	Block*			current_;
+	std::size_t		offset_;
+};
+
+/**
+Standard allocator forwarding to a MemoryResource.
+
+Like std::pmr::polymorphic_allocator, the resource is not propagated when
+containers are assigned, and copies of containers use the default resource.
+*/
+template <typename T>
+class Allocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef Allocator<U> other;
+	};
+
+	Allocator () noexcept
+	: resource_ (GetDefaultResource ())
+	{
+	}
+
+	Allocator (MemoryResource* resource) noexcept
+	: resource_ (resource)
+	{
+	}
+
+	template <typename U>
+	Allocator (const Allocator<U>& other) noexcept
+	: resource_ (other.GetResource ())
+	{
+	}
+
+	T* allocate (const std::size_t n)
+	{
+		return static_cast<T*> (resource_->Allocate (n * sizeof (T), alignof (T)));
+	}
+
+	void deallocate (T* p, const std::size_t n)
+	{
+		resource_->Deallocate (p, n * sizeof (T), alignof (T));
+	}
+
+	Allocator select_on_container_copy_construction () const
+	{
+		return Allocator ();
+	}
+
+	MemoryResource* GetResource () const noexcept
+	{
+		return resource_;
+	}
+
+private:
+	MemoryResource*	resource_;
+};
+
+template <typename T, typename U>
+bool operator== (const Allocator<T>& a, const Allocator<U>& b) noexcept
+{
+	return a.GetResource () == b.GetResource ();
+}
+
+template <typename T, typename U>
+bool operator!= (const Allocator<T>& a, const Allocator<U>& b) noexcept
+{
+	return a.GetResource () != b.GetResource ();
+}
+
+typedef std::basic_string<char, std::char_traits<char>, Allocator<char>> String;
+}
+
+#endif
@@ -0,0 +1,680 @@
+// Interception library which profiles every OpenCL kernel enqueue without
+// source changes. Preload it into an OpenCL application:
+//
+//     LD_PRELOAD=libAmdPerfIntercept.so ./application
+//
+// Every clEnqueueNDRangeKernel on the first command queue used is wrapped in a
+// sample, enqueues are batched into sessions of AMD_PERF_SESSION_SIZE samples.
+// Finished sessions are polled on later enqueues and their results passed to
+// the trace exporter and capture writer; only when more than
+// AMD_PERF_MAX_PENDING sessions are outstanding, an enqueue blocks on the
+// oldest one. Profiling ends when the profiled queue is released, or at exit.
+//
+// Configuration (environment variables):
+//   AMD_PERF_COUNTERS       Comma-separated counter names, default GPUTime.
+//                           Counters which would need more than one pass are
+//                           skipped, as enqueues cannot be repeated.
+//   AMD_PERF_SESSION_SIZE   Samples per session, default 64
+//   AMD_PERF_MAX_PENDING    Sessions to read back asynchronously, default 4
+//   AMD_PERF_TRACE          Trace file to write, see TraceExporter
+//   AMD_PERF_TRACE_FORMAT   json (default) or perfetto
+//   AMD_PERF_CAPTURE        Capture file to write, frames are sessions and
+//                           scopes are kernels, see CaptureWriter
+//   AMD_PERF_BUILD          Build label stored in the capture
+//
+// Any error disables profiling, the enqueues are still passed through.
+
+#include "Capture.h"
+#include "OpenCLTypes.h"
+#include "PerfLib.h"
+#include "TraceExporter.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#define NIV_INTERCEPT_EXPORT extern "C" __attribute__ ((visibility ("default")))
+
+namespace Amd {
+namespace {
+typedef cl_int (*EnqueueNDRangeKernelPtrType) (cl_command_queue, cl_kernel,
+	cl_uint, const std::size_t*, const std::size_t*, const std::size_t*,
+	cl_uint, const cl_event*, cl_event*);
+typedef cl_int (*GetKernelInfoPtrType) (cl_kernel, cl_kernel_info, std::size_t,
+	void*, std::size_t*);
+typedef cl_int (*ReleaseKernelPtrType) (cl_kernel);
+typedef cl_int (*ReleaseCommandQueuePtrType) (cl_command_queue);
+
+template <typename T>
+T LoadNext (const char* name)
+{
+	void* p = dlsym (RTLD_NEXT, name);
+	T result;
+	::memcpy (&result, &p, sizeof (void*));
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string GetEnvironment (const char* name, const char* defaultValue)
+{
+	const char* value = ::getenv (name);
+	return (value && *value) ? value : defaultValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t GetEnvironment (const char* name, const std::size_t defaultValue)
+{
+	const char* value = ::getenv (name);
+
+	if (value && *value) {
+		const auto result = ::strtoul (value, nullptr, 10);
+
+		if (result > 0) {
+			return result;
+		}
+	}
+
+	return defaultValue;
+}
+
+struct Config
+{
+	Config ()
+	: sessionSize (GetEnvironment ("AMD_PERF_SESSION_SIZE", static_cast<std::size_t> (64)))
+	, maxPending (GetEnvironment ("AMD_PERF_MAX_PENDING", static_cast<std::size_t> (4)))
+	, tracePath (GetEnvironment ("AMD_PERF_TRACE", ""))
+	, traceFormat (GetEnvironment ("AMD_PERF_TRACE_FORMAT", "json") == "perfetto"
+		? TraceFormat::Perfetto : TraceFormat::ChromeJson)
+	, capturePath (GetEnvironment ("AMD_PERF_CAPTURE", ""))
+	, build (GetEnvironment ("AMD_PERF_BUILD", ""))
+	{
+		std::istringstream names (GetEnvironment ("AMD_PERF_COUNTERS", "GPUTime"));
+		std::string name;
+
+		while (std::getline (names, name, ',')) {
+			if (!name.empty ()) {
+				counters.push_back (name);
+			}
+		}
+	}
+
+	std::vector<std::string>	counters;
+	std::size_t					sessionSize;
+	std::size_t					maxPending;
+	std::string					tracePath;
+	TraceFormat::Enum			traceFormat;
+	std::string					capturePath;
+	std::string					build;
+};
+
+struct PendingSession
+{
+	Session						session;
+	std::vector<std::uint32_t>	sampleIds;
+	std::vector<std::uint32_t>	kernelIds;
+	std::uint64_t				frame;
+};
+
+/**
+Set while a thread is inside the interceptor, so OpenCL calls made by
+GPUPerfAPI itself are passed through directly.
+*/
+thread_local bool insideInterceptor = false;
+
+struct ReentrancyGuard
+{
+	ReentrancyGuard ()
+	{
+		insideInterceptor = true;
+	}
+
+	~ReentrancyGuard ()
+	{
+		insideInterceptor = false;
+	}
+};
+
+void FinishAtExit ();
+
+class Interceptor
+{
+public:
+	Interceptor ()
+	: enqueue_ (LoadNext<EnqueueNDRangeKernelPtrType> ("clEnqueueNDRangeKernel"))
+	, getKernelInfo_ (LoadNext<GetKernelInfoPtrType> ("clGetKernelInfo"))
+	, releaseKernel_ (LoadNext<ReleaseKernelPtrType> ("clReleaseKernel"))
+	, releaseCommandQueue_ (LoadNext<ReleaseCommandQueuePtrType> ("clReleaseCommandQueue"))
+	, state_ (State::Idle)
+	, queue_ (nullptr)
+	, sampleId_ (0)
+	, sessionSamples_ (0)
+	, frame_ (0)
+	{
+	}
+
+	void FinishProfiling ()
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		ReentrancyGuard guard;
+
+		if (state_ == State::Active) {
+			Finish ();
+		}
+	}
+
+	cl_int Enqueue (cl_command_queue queue, cl_kernel kernel, cl_uint workDim,
+		const std::size_t* globalWorkOffset, const std::size_t* globalWorkSize,
+		const std::size_t* localWorkSize, cl_uint eventCount,
+		const cl_event* eventWaitList, cl_event* event)
+	{
+		if (enqueue_ == nullptr) {
+			return CL_INVALID_OPERATION;
+		}
+
+		// Enqueues on other queues, and all enqueues once profiling has ended,
+		// are passed through without taking the lock
+		const State::Enum state = state_.load (std::memory_order_acquire);
+
+		if (state == State::Disabled
+			|| (state == State::Active && queue != queue_.load (std::memory_order_relaxed))) {
+			return enqueue_ (queue, kernel, workDim, globalWorkOffset,
+				globalWorkSize, localWorkSize, eventCount, eventWaitList, event);
+		}
+
+		// Samples must not overlap, so enqueues on the profiled queue are
+		// serialized
+		std::lock_guard<std::mutex> lock (mutex_);
+		ReentrancyGuard guard;
+
+		std::uint32_t kernelId = 0;
+
+		try {
+			if (Start (queue)) {
+				kernelId = BeginSample (kernel);
+			}
+		} catch (const std::exception& e) {
+			Disable (e.what ());
+		}
+
+		const cl_int result = enqueue_ (queue, kernel, workDim, globalWorkOffset,
+			globalWorkSize, localWorkSize, eventCount, eventWaitList, event);
+
+		if (sample_.IsActive ()) {
+			try {
+				EndSample (kernelId, result == CL_SUCCESS);
+			} catch (const std::exception& e) {
+				Disable (e.what ());
+			}
+		}
+
+		return result;
+	}
+
+	cl_int ReleaseKernel (cl_kernel kernel)
+	{
+		if (releaseKernel_ == nullptr) {
+			return CL_INVALID_OPERATION;
+		}
+
+		// The handle may be reused for a different kernel. Kernel ids are not
+		// used anymore once profiling has ended.
+		if (state_.load (std::memory_order_acquire) != State::Disabled) {
+			std::lock_guard<std::mutex> lock (mutex_);
+			kernelIds_.erase (kernel);
+		}
+
+		return releaseKernel_ (kernel);
+	}
+
+	cl_int ReleaseCommandQueue (cl_command_queue queue)
+	{
+		if (releaseCommandQueue_ == nullptr) {
+			return CL_INVALID_OPERATION;
+		}
+
+		if (state_.load (std::memory_order_acquire) == State::Active
+			&& queue == queue_.load (std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock (mutex_);
+			ReentrancyGuard guard;
+
+			// The context must be closed while the queue is still alive
+			if (state_ == State::Active && queue == queue_) {
+				Finish ();
+			}
+		}
+
+		return releaseCommandQueue_ (queue);
+	}
+
+private:
+	struct State
+	{
+		enum Enum
+		{
+			Idle,		///< No kernel enqueued yet
+			Active,
+			Disabled	///< Finished or failed, enqueues are passed through
+		};
+	};
+
+	/**
+	Open the library, context and exporters on the first enqueue. Returns
+	whether enqueues on queue are profiled.
+	*/
+	bool Start (cl_command_queue queue)
+	{
+		if (state_ == State::Active) {
+			return queue == queue_;
+		} else if (state_ == State::Disabled) {
+			return false;
+		}
+
+		library_.reset (new PerformanceLibrary (ProfileApi::OpenCL));
+
+		if (!Check (library_->TryOpenContext (queue, context_), "GPA_OpenContext")) {
+			return false;
+		}
+
+		CounterSet all;
+		if (!Check (context_.TryGetAvailableCounters (all), "GetAvailableCounters")) {
+			return false;
+		}
+
+		std::vector<std::string> selected;
+
+		for (const auto& name : config_.counters) {
+			if (all.Find (name) == nullptr) {
+				::fprintf (stderr, "AmdPerfIntercept: Unknown counter '%s', skipped\n", name.c_str ());
+				continue;
+			}
+
+			CounterSet counter = all;
+			counter.Keep (std::vector<std::string> (1, name));
+
+			int passCount = 0;
+			if (!Check (counter.TryEnable (), "GPA_EnableCounter")
+				|| !Check (counter.TryGetRequiredPassCount (passCount), "GPA_GetPassCount")) {
+				return false;
+			}
+
+			if (passCount > 1) {
+				::fprintf (stderr, "AmdPerfIntercept: Counter '%s' needs another pass, skipped\n", name.c_str ());
+
+				if (!Check (counter.TryDisable (), "GPA_DisableCounter")) {
+					return false;
+				}
+			} else {
+				selected.push_back (name);
+			}
+		}
+
+		if (selected.empty ()) {
+			Disable ("No counters selected");
+			return false;
+		}
+
+		counters_ = all;
+		counters_.Keep (selected);
+
+		if (!config_.tracePath.empty ()) {
+			trace_.reset (new TraceExporter (config_.tracePath, config_.traceFormat));
+			library_->SetListener (trace_.get ());
+		}
+
+		if (!config_.capturePath.empty ()) {
+			capture_.reset (new CaptureWriter (config_.capturePath, counters_, config_.build));
+		}
+
+		queue_ = queue;
+		state_.store (State::Active, std::memory_order_release);
+
+		// Handlers run in reverse order of registration, so this one runs
+		// before GPUPerfAPI, which has just been loaded, is torn down
+		::atexit (&FinishAtExit);
+
+		return true;
+	}
+
+	/**
+	Begin a sample for kernel, and a session if none is active. Returns the
+	kernel id.
+	*/
+	std::uint32_t BeginSample (cl_kernel kernel)
+	{
+		const std::uint32_t kernelId = GetKernelId (kernel);
+
+		if (!session_.IsActive ()) {
+			if (!Check (context_.TryBeginSession (session_), "GPA_BeginSession")
+				|| !Check (session_.TryBeginPass (pass_), "GPA_BeginPass")) {
+				return kernelId;
+			}
+
+			occurrences_.assign (kernelNames_.size (), 0);
+			sessionSamples_ = 0;
+		}
+
+		// Ids are unique within a session and always map to the same kernel,
+		// so the trace exporter can name the samples
+		occurrences_.resize (kernelNames_.size (), 0);
+		const std::uint32_t occurrence = occurrences_ [kernelId]++;
+		const std::uint32_t sampleId = static_cast<std::uint32_t> (
+			kernelId * config_.sessionSize + occurrence);
+
+		if (trace_) {
+			auto& named = namedOccurrences_ [kernelId];
+
+			for (; named <= occurrence; ++named) {
+				trace_->SetSampleName (static_cast<std::uint32_t> (
+					kernelId * config_.sessionSize + named), kernelNames_ [kernelId]);
+			}
+		}
+
+		if (Check (pass_.TryBeginSample (sampleId, sample_), "GPA_BeginSample")) {
+			sampleId_ = sampleId;
+		}
+
+		return kernelId;
+	}
+
+	void EndSample (const std::uint32_t kernelId, const bool enqueued)
+	{
+		if (!Check (sample_.TryEnd (), "GPA_EndSample")) {
+			return;
+		}
+
+		// Failed enqueues leave an empty sample, which is not read back
+		if (enqueued) {
+			sampleIds_.push_back (sampleId_);
+			sampleKernels_.push_back (kernelId);
+		}
+
+		if (++sessionSamples_ >= config_.sessionSize && !EndSession ()) {
+			return;
+		}
+
+		Poll (false);
+	}
+
+	bool EndSession ()
+	{
+		if (!session_.IsActive ()) {
+			return true;
+		}
+
+		if (!Check (pass_.TryEnd (), "GPA_EndPass")
+			|| !Check (session_.TryEnd (), "GPA_EndSession")) {
+			return false;
+		}
+
+		PendingSession pending;
+		pending.session = std::move (session_);
+		pending.sampleIds.swap (sampleIds_);
+		pending.kernelIds.swap (sampleKernels_);
+		pending.frame = frame_++;
+
+		pending_.push_back (std::move (pending));
+
+		return true;
+	}
+
+	/**
+	Read back finished sessions, oldest first. Blocks if block is set or too
+	many sessions are outstanding.
+	*/
+	void Poll (const bool block)
+	{
+		while (!pending_.empty ()) {
+			bool ready = block || pending_.size () > config_.maxPending;
+
+			if (!ready && !Check (pending_.front ().session.TryIsReady (ready), "GPA_IsSessionReady")) {
+				return;
+			}
+
+			if (!ready || !Collect (pending_.front ())) {
+				return;
+			}
+
+			pending_.pop_front ();
+		}
+	}
+
+	bool Collect (PendingSession& pending)
+	{
+		for (std::size_t i = 0; i < pending.sampleIds.size (); ++i) {
+			FrameResult result (&arena_);
+
+			if (!Check (pending.session.TryGetSampleResult (pending.sampleIds [i], true, result),
+				"GetSampleResult")) {
+				return false;
+			}
+
+			if (capture_) {
+				capture_->Write (pending.frame, pending.kernelIds [i], result);
+			}
+		}
+
+		arena_.Reset ();
+
+		return true;
+	}
+
+	std::uint32_t GetKernelId (cl_kernel kernel)
+	{
+		auto it = kernelIds_.find (kernel);
+
+		if (it != kernelIds_.end ()) {
+			return it->second;
+		}
+
+		std::string name = "Unknown kernel";
+		std::size_t size = 0;
+
+		if (getKernelInfo_ && getKernelInfo_ (kernel, CL_KERNEL_FUNCTION_NAME, 0, nullptr, &size) == CL_SUCCESS
+			&& size > 0) {
+			std::vector<char> buffer (size);
+
+			if (getKernelInfo_ (kernel, CL_KERNEL_FUNCTION_NAME, size, buffer.data (), nullptr) == CL_SUCCESS) {
+				name.assign (buffer.data ());
+			}
+		}
+
+		// Kernel objects created from the same function share their id
+		auto nameIt = kernelsByName_.find (name);
+		std::uint32_t kernelId = 0;
+
+		if (nameIt != kernelsByName_.end ()) {
+			kernelId = nameIt->second;
+		} else {
+			kernelId = static_cast<std::uint32_t> (kernelNames_.size ());
+			kernelNames_.push_back (name);
+			namedOccurrences_.push_back (0);
+			kernelsByName_ [name] = kernelId;
+
+			if (capture_) {
+				capture_->SetScopeName (kernelId, name);
+			}
+		}
+
+		kernelIds_ [kernel] = kernelId;
+
+		return kernelId;
+	}
+
+	/**
+	Read back all outstanding results and shut down.
+	*/
+	void Finish ()
+	{
+		try {
+			if (EndSession ()) {
+				Poll (true);
+			}
+
+			if (capture_) {
+				capture_->Close ();
+			}
+		} catch (const std::exception& e) {
+			::fprintf (stderr, "AmdPerfIntercept: %s\n", e.what ());
+		}
+
+		Shutdown ();
+	}
+
+	bool Check (const int status, const char* operation)
+	{
+		if (status != ErrorCode::Ok) {
+			std::ostringstream reason;
+			reason << operation << " failed with " << status;
+			Disable (reason.str ().c_str ());
+			return false;
+		}
+
+		return true;
+	}
+
+	void Disable (const char* reason)
+	{
+		::fprintf (stderr, "AmdPerfIntercept: %s, profiling disabled\n", reason);
+		Shutdown ();
+	}
+
+	/**
+	Release everything without reading back outstanding results. Errors are
+	ignored, as there is nothing left to do about them.
+	*/
+	void Shutdown ()
+	{
+		if (sample_.IsActive ()) {
+			sample_.TryEnd ();
+		}
+		sample_ = Sample ();
+
+		if (pass_.IsActive ()) {
+			pass_.TryEnd ();
+		}
+		pass_ = Pass ();
+
+		if (session_.IsActive ()) {
+			session_.TryEnd ();
+		}
+		session_ = Session ();
+
+		pending_.clear ();
+
+		if (library_) {
+			library_->SetListener (nullptr);
+		}
+
+		trace_.reset ();
+		capture_.reset ();
+		counters_ = CounterSet ();
+
+		context_.TryClose ();
+		context_ = Context ();
+
+		library_.reset ();
+
+		state_ = State::Disabled;
+	}
+
+	Config								config_;
+
+	EnqueueNDRangeKernelPtrType			enqueue_;
+	GetKernelInfoPtrType				getKernelInfo_;
+	ReleaseKernelPtrType				releaseKernel_;
+	ReleaseCommandQueuePtrType			releaseCommandQueue_;
+
+	/**
+	Changed only with mutex_ held, but read without it to pass enqueues
+	through. queue_ is set before state_ becomes Active and not changed
+	afterwards.
+	*/
+	std::mutex							mutex_;
+	std::atomic<State::Enum>			state_;
+	std::atomic<cl_command_queue>		queue_;
+
+	std::unique_ptr<PerformanceLibrary>	library_;
+	std::unique_ptr<TraceExporter>		trace_;
+	std::unique_ptr<CaptureWriter>		capture_;
+	FrameArena							arena_;
+
+	Context								context_;
+	CounterSet							counters_;
+	Session								session_;
+	Pass								pass_;
+	Sample								sample_;
+	std::uint32_t						sampleId_;
+	std::size_t							sessionSamples_;
+
+	std::vector<std::uint32_t>			sampleIds_;		///< Of the active session
+	std::vector<std::uint32_t>			sampleKernels_;	///< Kernel id of each entry in sampleIds_
+	std::vector<std::uint32_t>			occurrences_;	///< Samples per kernel in the active session
+	std::deque<PendingSession>			pending_;
+	std::uint64_t						frame_;
+
+	std::unordered_map<cl_kernel, std::uint32_t>	kernelIds_;
+	std::unordered_map<std::string, std::uint32_t>	kernelsByName_;
+	std::vector<std::string>						kernelNames_;
+	std::vector<std::uint32_t>						namedOccurrences_;	///< Sample ids named in the trace per kernel
+};
+
+////////////////////////////////////////////////////////////////////////////////
+Interceptor& GetInterceptor ()
+{
+	static Interceptor interceptor;
+	return interceptor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FinishAtExit ()
+{
+	GetInterceptor ().FinishProfiling ();
+}
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NIV_INTERCEPT_EXPORT cl_int clEnqueueNDRangeKernel (cl_command_queue queue,
+	cl_kernel kernel, cl_uint workDim, const std::size_t* globalWorkOffset,
+	const std::size_t* globalWorkSize, const std::size_t* localWorkSize,
+	cl_uint eventCount, const cl_event* eventWaitList, cl_event* event)
+{
+	if (Amd::insideInterceptor) {
+		static const auto enqueue = Amd::LoadNext<Amd::EnqueueNDRangeKernelPtrType> ("clEnqueueNDRangeKernel");
+		return enqueue (queue, kernel, workDim, globalWorkOffset, globalWorkSize,
+			localWorkSize, eventCount, eventWaitList, event);
+	}
+
+	return Amd::GetInterceptor ().Enqueue (queue, kernel, workDim, globalWorkOffset,
+		globalWorkSize, localWorkSize, eventCount, eventWaitList, event);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NIV_INTERCEPT_EXPORT cl_int clReleaseKernel (cl_kernel kernel)
+{
+	if (Amd::insideInterceptor) {
+		static const auto release = Amd::LoadNext<Amd::ReleaseKernelPtrType> ("clReleaseKernel");
+		return release (kernel);
+	}
+
+	return Amd::GetInterceptor ().ReleaseKernel (kernel);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NIV_INTERCEPT_EXPORT cl_int clReleaseCommandQueue (cl_command_queue queue)
+{
+	if (Amd::insideInterceptor) {
+		static const auto release = Amd::LoadNext<Amd::ReleaseCommandQueuePtrType> ("clReleaseCommandQueue");
+		return release (queue);
+	}
+
+	return Amd::GetInterceptor ().ReleaseCommandQueue (queue);
+}
@@ -0,0 +1,72 @@
+// Stand-in for the OpenCL runtime, providing just the entry points wrapped by
+// the interception library (see OpenCLIntercept.cpp). It is built with the
+// file name of the OpenCL library, so a program linked against it can be run
+// with the interception library preloaded and without a GPU.
+//
+// Kernel handles are pointers to the kernel name as a C string, command queues
+// are opaque. Enqueues succeed for all non-null kernels and do nothing.
+
+#include "OpenCLTypes.h"
+
+#include <string.h>
+
+#define NIV_CL_STUB_EXPORT extern "C" __attribute__ ((visibility ("default")))
+
+////////////////////////////////////////////////////////////////////////////////
+NIV_CL_STUB_EXPORT cl_int clEnqueueNDRangeKernel (cl_command_queue,
+	cl_kernel kernel, cl_uint, const std::size_t*, const std::size_t*,
+	const std::size_t*, cl_uint, const cl_event*, cl_event* event)
+{
+	if (kernel == nullptr) {
+		return CL_INVALID_KERNEL;
+	}
+
+	if (event) {
+		*event = nullptr;
+	}
+
+	return CL_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NIV_CL_STUB_EXPORT cl_int clGetKernelInfo (cl_kernel kernel,
+	cl_kernel_info paramName, std::size_t paramValueSize, void* paramValue,
+	std::size_t* paramValueSizeReturn)
+{
+	if (kernel == nullptr) {
+		return CL_INVALID_KERNEL;
+	}
+
+	if (paramName != CL_KERNEL_FUNCTION_NAME) {
+		return CL_INVALID_VALUE;
+	}
+
+	const char* name = reinterpret_cast<const char*> (kernel);
+	const std::size_t size = ::strlen (name) + 1;
+
+	if (paramValue) {
+		if (paramValueSize < size) {
+			return CL_INVALID_VALUE;
+		}
+
+		::memcpy (paramValue, name, size);
+	}
+
+	if (paramValueSizeReturn) {
+		*paramValueSizeReturn = size;
+	}
+
+	return CL_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NIV_CL_STUB_EXPORT cl_int clReleaseKernel (cl_kernel kernel)
+{
+	return kernel ? CL_SUCCESS : CL_INVALID_KERNEL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NIV_CL_STUB_EXPORT cl_int clReleaseCommandQueue (cl_command_queue)
+{
+	return CL_SUCCESS;
+}
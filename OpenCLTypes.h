@@ -0,0 +1,25 @@
+#ifndef NIV_AMD_PERF_LIB_OPENCLTYPES_H_5E1B7D3A_2C94_4A6F_B8E0_7F3D91C4A2E5
+#define NIV_AMD_PERF_LIB_OPENCLTYPES_H_5E1B7D3A_2C94_4A6F_B8E0_7F3D91C4A2E5
+
+// The subset of the OpenCL API used by the interception library and its
+// stand-in runtime, so neither needs the OpenCL headers.
+
+#include <cstddef>
+#include <cstdint>
+
+typedef std::int32_t	cl_int;
+typedef std::uint32_t	cl_uint;
+typedef cl_uint			cl_kernel_info;
+
+typedef struct _cl_command_queue*	cl_command_queue;
+typedef struct _cl_kernel*			cl_kernel;
+typedef struct _cl_event*			cl_event;
+
+#define CL_SUCCESS					0
+#define CL_INVALID_VALUE			-30
+#define CL_INVALID_KERNEL			-48
+#define CL_INVALID_OPERATION		-59
+
+#define CL_KERNEL_FUNCTION_NAME		0x1190
+
+#endif
@@ -0,0 +1,355 @@
+// Measures the overhead of the wrapper against the stand-in GPUPerfAPI library
+// (see GPUPerfAPIStub.cpp), which has to be loadable as the OpenCL GPUPerfAPI
+// library, for instance by placing it next to this executable.
+//
+// Usage: AmdPerfBenchmark [--format <json|csv>] [--repetitions <n>] [--scale <f>]
+//
+// Every benchmark is run repetitions times, the minimum and median time per
+// operation in nanoseconds are reported. scale multiplies all iteration counts.
+
+#include "PerfLib.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+
+namespace {
+struct Options
+{
+	Options ()
+	: csv (false)
+	, repetitions (5)
+	, scale (1)
+	{
+	}
+
+	bool	csv;
+	int		repetitions;
+	double	scale;
+};
+
+struct Result
+{
+	std::string		name;
+	int				counters;
+	int				samples;
+	std::uint64_t	iterations;
+	double			minimum;	///< Nanoseconds per operation
+	double			median;		///< Nanoseconds per operation
+};
+
+// Prevents the compiler from removing otherwise unused results
+volatile std::size_t sink = 0;
+
+class Benchmark
+{
+public:
+	Benchmark (const Options& options)
+	: options_ (options)
+	{
+	}
+
+	/**
+	Run f (iterations) repeatedly, where f performs iterations operations.
+	*/
+	template <typename F>
+	void Run (const std::string& name, const int counters, const int samples,
+		const std::uint64_t baseIterations, F f)
+	{
+		const auto iterations = std::max<std::uint64_t> (1,
+			static_cast<std::uint64_t> (baseIterations * options_.scale));
+
+		std::vector<double> times;
+
+		// Untimed, so one-time costs such as growing a FrameArena are excluded
+		f (1);
+
+		for (int i = 0; i < options_.repetitions; ++i) {
+			const auto start = std::chrono::steady_clock::now ();
+			f (iterations);
+			const auto end = std::chrono::steady_clock::now ();
+
+			times.push_back (std::chrono::duration<double, std::nano> (end - start).count ()
+				/ static_cast<double> (iterations));
+		}
+
+		std::sort (times.begin (), times.end ());
+
+		Result result;
+		result.name = name;
+		result.counters = counters;
+		result.samples = samples;
+		result.iterations = iterations;
+		result.minimum = times.front ();
+		result.median = times [times.size () / 2];
+		results_.push_back (result);
+
+		std::cerr << name << " (counters=" << counters << ", samples=" << samples
+			<< "): " << result.median << " ns" << std::endl;
+	}
+
+	void Print () const
+	{
+		if (options_.csv) {
+			::printf ("name,counters,samples,iterations,ns_per_op_min,ns_per_op_median\n");
+
+			for (const auto& r : results_) {
+				::printf ("%s,%d,%d,%llu,%.3f,%.3f\n", r.name.c_str (), r.counters,
+					r.samples, static_cast<unsigned long long> (r.iterations),
+					r.minimum, r.median);
+			}
+		} else {
+			::printf ("{\"benchmarks\":[\n");
+
+			for (std::size_t i = 0; i < results_.size (); ++i) {
+				const auto& r = results_ [i];
+				::printf ("{\"name\":\"%s\",\"counters\":%d,\"samples\":%d,\"iterations\":%llu,"
+					"\"ns_per_op_min\":%.3f,\"ns_per_op_median\":%.3f}%s\n",
+					r.name.c_str (), r.counters, r.samples,
+					static_cast<unsigned long long> (r.iterations),
+					r.minimum, r.median, i + 1 < results_.size () ? "," : "");
+			}
+
+			::printf ("]}\n");
+		}
+	}
+
+private:
+	const Options&		options_;
+	std::vector<Result>	results_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<std::string> FirstCounters (const Amd::CounterSet& counters, const int count)
+{
+	std::vector<std::pair<int, std::string>> byIndex;
+	for (const auto& kv : counters) {
+		byIndex.emplace_back (kv.second.index, kv.first);
+	}
+	std::sort (byIndex.begin (), byIndex.end ());
+
+	std::vector<std::string> result;
+	for (int i = 0; i < count && i < static_cast<int> (byIndex.size ()); ++i) {
+		result.push_back (byIndex [i].second);
+	}
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RunLifecycle (Benchmark& benchmark, Amd::Context& context)
+{
+	benchmark.Run ("Session.BeginEnd", 1, 0, 100000, [&] (const std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i) {
+			auto session = context.BeginSession ();
+			session.End ();
+		}
+	});
+
+	{
+		auto session = context.BeginSession ();
+
+		benchmark.Run ("Pass.BeginEnd", 1, 0, 100000, [&] (const std::uint64_t n) {
+			for (std::uint64_t i = 0; i < n; ++i) {
+				auto pass = session.BeginPass ();
+				pass.End ();
+			}
+		});
+
+		auto pass = session.BeginPass ();
+
+		benchmark.Run ("Sample.BeginEnd", 1, 0, 1000000, [&] (const std::uint64_t n) {
+			for (std::uint64_t i = 0; i < n; ++i) {
+				auto sample = pass.BeginSample (static_cast<std::uint32_t> (i));
+				sample.End ();
+			}
+		});
+
+		benchmark.Run ("Sample.Move", 1, 0, 1000000, [&] (const std::uint64_t n) {
+			auto sample = pass.BeginSample (0);
+			for (std::uint64_t i = 0; i < n; ++i) {
+				Amd::Sample moved (std::move (sample));
+				sample = std::move (moved);
+			}
+		});
+
+		benchmark.Run ("Pass.Move", 1, 0, 1000000, [&] (const std::uint64_t n) {
+			for (std::uint64_t i = 0; i < n; ++i) {
+				Amd::Pass moved (std::move (pass));
+				pass = std::move (moved);
+			}
+		});
+
+		benchmark.Run ("Session.Move", 1, 0, 1000000, [&] (const std::uint64_t n) {
+			for (std::uint64_t i = 0; i < n; ++i) {
+				Amd::Session moved (std::move (session));
+				session = std::move (moved);
+			}
+		});
+	}
+
+	benchmark.Run ("Context.Move", 1, 0, 1000000, [&] (const std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i) {
+			Amd::Context moved (std::move (context));
+			context = std::move (moved);
+		}
+	});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RunCounters (Benchmark& benchmark, Amd::Context& context)
+{
+	const auto all = context.GetAvailableCounters ();
+	const int counterCount = static_cast<int> (std::distance (all.begin (), all.end ()));
+
+	benchmark.Run ("Context.GetAvailableCounters", counterCount, 0, 200, [&] (const std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i) {
+			const auto counters = context.GetAvailableCounters ();
+			sink += counters.begin () != counters.end ();
+		}
+	});
+
+	benchmark.Run ("CounterSet.Copy", counterCount, 0, 2000, [&] (const std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i) {
+			Amd::CounterSet copy (all);
+			sink += copy.begin () != copy.end ();
+		}
+	});
+
+	const auto keep = FirstCounters (all, 64);
+
+	benchmark.Run ("CounterSet.Keep", 64, 0, 2000, [&] (const std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i) {
+			Amd::CounterSet copy (all);
+			copy.Keep (keep);
+			sink += copy.begin () != copy.end ();
+		}
+	});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RunGetResult (Benchmark& benchmark, Amd::Context& context)
+{
+	const auto all = context.GetAvailableCounters ();
+
+	static const int counterCounts [] = { 1, 10, 50, 100, 250, 500 };
+	static const int sampleCounts [] = { 1, 16, 256 };
+
+	for (const auto counterCount : counterCounts) {
+		auto counters = all;
+		counters.Keep (FirstCounters (all, counterCount));
+		counters.Enable ();
+
+		for (const auto sampleCount : sampleCounts) {
+			auto session = context.BeginSession ();
+			{
+				auto pass = session.BeginPass ();
+				for (int i = 0; i < sampleCount; ++i) {
+					pass.BeginSample (static_cast<std::uint32_t> (i)).End ();
+				}
+			}
+			session.End ();
+
+			// One operation reads back all samples of the session
+			benchmark.Run ("Session.GetSampleResult", counterCount, sampleCount,
+				std::max (1, 20000 / (counterCount * sampleCount)),
+				[&] (const std::uint64_t n) {
+				for (std::uint64_t i = 0; i < n; ++i) {
+					for (int s = 0; s < sampleCount; ++s) {
+						sink += session.GetSampleResult (static_cast<std::uint32_t> (s), true).size ();
+					}
+				}
+			});
+
+			// Same, reading into a per-frame arena which is reset after each
+			// operation
+			Amd::FrameArena arena;
+
+			benchmark.Run ("Session.GetSampleResult.FrameArena", counterCount, sampleCount,
+				std::max (1, 20000 / (counterCount * sampleCount)),
+				[&] (const std::uint64_t n) {
+				for (std::uint64_t i = 0; i < n; ++i) {
+					for (int s = 0; s < sampleCount; ++s) {
+						sink += session.GetSampleResult (static_cast<std::uint32_t> (s), true, &arena).size ();
+					}
+					arena.Reset ();
+				}
+			});
+		}
+
+		counters.Disable ();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ParseOptions (int argc, char* argv [], Options& options)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv [i];
+
+		if (i + 1 >= argc) {
+			return false;
+		}
+
+		const std::string value = argv [++i];
+
+		if (arg == "--format") {
+			if (value != "json" && value != "csv") {
+				return false;
+			}
+			options.csv = value == "csv";
+		} else if (arg == "--repetitions") {
+			options.repetitions = std::max (1, std::stoi (value));
+		} else if (arg == "--scale") {
+			options.scale = std::stod (value);
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+}
+
+int main (int argc, char* argv [])
+{
+	Options options;
+
+	try {
+		if (!ParseOptions (argc, argv, options)) {
+			std::cerr << "Usage: AmdPerfBenchmark [--format <json|csv>] "
+				"[--repetitions <n>] [--scale <f>]" << std::endl;
+			return 2;
+		}
+
+		Benchmark benchmark (options);
+
+		Amd::PerformanceLibrary library (Amd::ProfileApi::OpenCL);
+
+		// The stand-in library ignores the context, but Context only closes
+		// non-null ones
+		static int dummyContext;
+		auto context = library.OpenContext (&dummyContext);
+
+		RunCounters (benchmark, context);
+
+		{
+			auto counters = context.GetAvailableCounters ();
+			counters.Keep (FirstCounters (counters, 1));
+			counters.Enable ();
+
+			RunLifecycle (benchmark, context);
+
+			counters.Disable ();
+		}
+
+		RunGetResult (benchmark, context);
+
+		benchmark.Print ();
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what () << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
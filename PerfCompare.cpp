@@ -0,0 +1,354 @@
+// Compares two captures written by CaptureWriter and reports, for every scope
+// and counter present in both, whether the values changed significantly.
+//
+// Usage: AmdPerfCompare [options] <baseline> <candidate>
+//
+//	--counter <name>			Only compare this counter, can be repeated
+//	--threshold <name>=<pct>	Fail if the counter regresses by more than pct
+//								percent. Positive values treat increases as
+//								regressions (e.g. GPUTime=5), negative values
+//								decreases (e.g. PSBusy=-5)
+//	--default-threshold <pct>	Threshold for all counters without explicit one
+//	--alpha <p>					Significance level, default 0.05
+//	--test <mann-whitney|bootstrap>
+//	--iterations <n>			Bootstrap iterations, default 2000
+//	--threads <n>				Worker threads, default all cores
+//
+// Exits with 0 if no counter regressed, 1 if at least one regressed beyond its
+// threshold with significance, and 2 on errors.
+
+#include "Capture.h"
+#include "Statistics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdio.h>
+#include <thread>
+
+namespace {
+struct Test
+{
+	enum Enum
+	{
+		MannWhitney,
+		Bootstrap
+	};
+};
+
+struct Options
+{
+	Options ()
+	: alpha (0.05)
+	, test (Test::MannWhitney)
+	, iterations (2000)
+	, threadCount (std::max (1u, std::thread::hardware_concurrency ()))
+	, hasDefaultThreshold (false)
+	, defaultThreshold (0)
+	{
+	}
+
+	std::string							baseline;
+	std::string							candidate;
+	std::vector<std::string>			counters;
+	std::map<std::string, double>		thresholds;
+	double								alpha;
+	Test::Enum							test;
+	int									iterations;
+	unsigned int						threadCount;
+	bool								hasDefaultThreshold;
+	double								defaultThreshold;
+};
+
+// Scope name, counter name
+typedef std::pair<std::string, std::string> Key;
+typedef std::map<Key, std::vector<double>> Samples;
+
+struct Comparison
+{
+	Key						key;
+	const std::vector<double>*	baseline;
+	const std::vector<double>*	candidate;
+
+	double					baselineMean;
+	double					candidateMean;
+	double					delta;		///< Relative change in percent
+	double					p;
+	bool					regressed;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void ParallelFor (const std::size_t count, const unsigned int threadCount, F f)
+{
+	std::atomic<std::size_t> next (0);
+	std::vector<std::thread> threads;
+
+	for (unsigned int t = 0; t < threadCount; ++t) {
+		threads.emplace_back ([&] () {
+			for (std::size_t i = next++; i < count; i = next++) {
+				f (i);
+			}
+		});
+	}
+
+	for (auto& thread : threads) {
+		thread.join ();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Samples Load (const std::string& filename, const Options& options)
+{
+	Amd::CaptureReader reader (filename);
+
+	const auto& counters = reader.GetCounters ();
+	std::vector<bool> selected (counters.size (), options.counters.empty ());
+
+	for (std::size_t i = 0; i < counters.size (); ++i) {
+		if (std::find (options.counters.begin (), options.counters.end (),
+			counters [i].name) != options.counters.end ()) {
+			selected [i] = true;
+		}
+	}
+
+	// Group each chunk of records separately, then merge
+	const std::size_t recordCount = reader.GetRecordCount ();
+	const std::size_t chunkSize = 1 << 20;
+	const std::size_t chunkCount = (recordCount + chunkSize - 1) / chunkSize;
+
+	typedef std::map<std::pair<std::uint32_t, std::uint32_t>, std::vector<double>> ChunkSamples;
+	std::vector<ChunkSamples> chunks (chunkCount);
+
+	ParallelFor (chunkCount, options.threadCount, [&] (const std::size_t chunk) {
+		const auto end = std::min (recordCount, (chunk + 1) * chunkSize);
+
+		for (std::size_t i = chunk * chunkSize; i < end; ++i) {
+			const auto record = reader.GetRecord (i);
+
+			if (record.counter < selected.size () && selected [record.counter]) {
+				chunks [chunk][std::make_pair (record.scope, record.counter)].push_back (
+					reader.GetValue (record));
+			}
+		}
+	});
+
+	Samples result;
+
+	for (const auto& chunk : chunks) {
+		for (const auto& kv : chunk) {
+			auto& values = result [Key (reader.GetScopeName (kv.first.first),
+				counters [kv.first.second].name)];
+			values.insert (values.end (), kv.second.begin (), kv.second.end ());
+		}
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool GetThreshold (const Options& options, const std::string& counter, double& threshold)
+{
+	auto it = options.thresholds.find (counter);
+
+	if (it != options.thresholds.end ()) {
+		threshold = it->second;
+		return true;
+	} else if (options.hasDefaultThreshold) {
+		threshold = options.defaultThreshold;
+		return true;
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Compare (Comparison& c, const Options& options)
+{
+	c.baselineMean = Amd::Mean (*c.baseline);
+	c.candidateMean = Amd::Mean (*c.candidate);
+
+	if (c.baselineMean != 0) {
+		c.delta = (c.candidateMean - c.baselineMean) / std::abs (c.baselineMean) * 100;
+	} else {
+		c.delta = c.candidateMean == 0 ? 0 : HUGE_VAL;
+	}
+
+	switch (options.test) {
+	case Test::MannWhitney:
+		c.p = Amd::MannWhitneyP (*c.baseline, *c.candidate);
+		break;
+	case Test::Bootstrap:
+		c.p = Amd::BootstrapP (*c.baseline, *c.candidate, options.iterations,
+			std::hash<std::string> () (c.key.first + "/" + c.key.second));
+		break;
+	}
+
+	c.regressed = false;
+	double threshold = 0;
+
+	if (c.p < options.alpha && GetThreshold (options, c.key.second, threshold)) {
+		if (threshold >= 0) {
+			c.regressed = c.delta > threshold;
+		} else {
+			c.regressed = c.delta < threshold;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PrintUsage ()
+{
+	std::cerr << "Usage: AmdPerfCompare [--counter <name>] [--threshold <name>=<pct>] "
+		"[--default-threshold <pct>] [--alpha <p>] [--test <mann-whitney|bootstrap>] "
+		"[--iterations <n>] [--threads <n>] <baseline> <candidate>" << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ParseOptions (int argc, char* argv [], Options& options)
+{
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv [i];
+
+		if (arg.size () > 2 && arg [0] == '-' && arg [1] == '-') {
+			if (i + 1 >= argc) {
+				return false;
+			}
+
+			const std::string value = argv [++i];
+
+			if (arg == "--counter") {
+				options.counters.push_back (value);
+			} else if (arg == "--threshold") {
+				const auto separator = value.find ('=');
+				if (separator == std::string::npos) {
+					return false;
+				}
+				options.thresholds [value.substr (0, separator)] =
+					std::stod (value.substr (separator + 1));
+			} else if (arg == "--default-threshold") {
+				options.hasDefaultThreshold = true;
+				options.defaultThreshold = std::stod (value);
+			} else if (arg == "--alpha") {
+				options.alpha = std::stod (value);
+			} else if (arg == "--test") {
+				if (value == "mann-whitney") {
+					options.test = Test::MannWhitney;
+				} else if (value == "bootstrap") {
+					options.test = Test::Bootstrap;
+				} else {
+					return false;
+				}
+			} else if (arg == "--iterations") {
+				options.iterations = std::max (1, std::stoi (value));
+			} else if (arg == "--threads") {
+				options.threadCount = static_cast<unsigned int> (std::max (1, std::stoi (value)));
+			} else {
+				return false;
+			}
+		} else {
+			files.push_back (arg);
+		}
+	}
+
+	if (files.size () != 2) {
+		return false;
+	}
+
+	options.baseline = files [0];
+	options.candidate = files [1];
+
+	return true;
+}
+}
+
+int main (int argc, char* argv [])
+{
+	Options options;
+
+	try {
+		if (!ParseOptions (argc, argv, options)) {
+			PrintUsage ();
+			return 2;
+		}
+
+		Samples baseline, candidate;
+
+		std::exception_ptr baselineError, candidateError;
+
+		std::thread loadBaseline ([&] () {
+			try {
+				baseline = Load (options.baseline, options);
+			} catch (...) {
+				baselineError = std::current_exception ();
+			}
+		});
+
+		try {
+			candidate = Load (options.candidate, options);
+		} catch (...) {
+			candidateError = std::current_exception ();
+		}
+		loadBaseline.join ();
+
+		if (baselineError) {
+			std::rethrow_exception (baselineError);
+		} else if (candidateError) {
+			std::rethrow_exception (candidateError);
+		}
+
+		std::vector<Comparison> comparisons;
+
+		for (const auto& kv : baseline) {
+			auto it = candidate.find (kv.first);
+
+			if (it == candidate.end () || kv.second.empty () || it->second.empty ()) {
+				std::cerr << "Skipping " << kv.first.first << "/" << kv.first.second
+					<< ": not present in both captures" << std::endl;
+				continue;
+			}
+
+			Comparison c;
+			c.key = kv.first;
+			c.baseline = &kv.second;
+			c.candidate = &it->second;
+			comparisons.push_back (c);
+		}
+
+		ParallelFor (comparisons.size (), options.threadCount, [&] (const std::size_t i) {
+			Compare (comparisons [i], options);
+		});
+
+		int regressions = 0;
+
+		::printf ("%-24s %-32s %8s %8s %14s %14s %9s %9s\n", "scope", "counter",
+			"n(base)", "n(cand)", "mean(base)", "mean(cand)", "delta%", "p");
+
+		for (const auto& c : comparisons) {
+			::printf ("%-24s %-32s %8zu %8zu %14.6g %14.6g %+9.2f %9.4f%s\n",
+				c.key.first.c_str (), c.key.second.c_str (),
+				c.baseline->size (), c.candidate->size (),
+				c.baselineMean, c.candidateMean, c.delta, c.p,
+				c.regressed ? "  REGRESSION" : (c.p < options.alpha ? "  changed" : ""));
+
+			if (c.regressed) {
+				++regressions;
+			}
+		}
+
+		if (regressions > 0) {
+			std::cerr << regressions << " counter(s) regressed" << std::endl;
+			return 1;
+		}
+
+		return 0;
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what () << std::endl;
+		return 2;
+	}
+}
@@ -1,5 +1,6 @@
 #include "PerfLib.h"
-#include "GPUPerfAPI.h"
+#include "CallLog.h"
+#include "ImportTable.h"
 
 #if AMD_PERF_API_LINUX
 	#include <dlfcn.h>	//dyopen, dlsym, dlclose
@@ -13,13 +14,11 @@
 
 #include <stdio.h>
 #include <cstdlib>
-#include <set>
+#include <tuple>
 
 #include <iostream>
 #include <stdexcept>
 
-#define NIV_SAFE_GPA(expr) do { const auto r = (expr); if (r != GPA_STATUS_OK) throw Exception (r); } while (0)
-
 namespace Amd {
 namespace {
 template <typename T>
@@ -50,16 +49,81 @@ void* LoadFunction (LibraryHandle lib, const char* name)
 #endif
 
 	if (result == nullptr) {
-		throw std::runtime_error (std::string ("Could not load function: ") + name);
+		NIV_THROW (std::runtime_error (std::string ("Could not load function: ") + name));
 	}
 
 	return result;
 }
+
+void NotifyResult (SessionListener& listener, const std::uint32_t sessionId,
+	const std::uint32_t sampleId, const SessionResult& result)
+{
+	listener.OnSampleResult (sessionId, sampleId, result);
+}
+
+void NotifyResult (SessionListener& listener, const std::uint32_t sessionId,
+	const std::uint32_t sampleId, const FrameResult& result)
+{
+	SessionResult copy;
+
+	for (const auto& kv : result) {
+		copy.emplace (std::string (kv.first.data (), kv.first.size ()), kv.second);
+	}
+
+	listener.OnSampleResult (sessionId, sampleId, copy);
+}
+
+void LoadImportTable (LibraryHandle lib, Internal::ImportTable& table)
+{
+	table.initialize 			= function_pointer_cast<GPA_InitializePtrType> (LoadFunction (lib, "GPA_Initialize"));
+	table.destroy 				= function_pointer_cast<GPA_DestroyPtrType> (LoadFunction (lib, "GPA_Destroy"));
+	table.openContext 			= function_pointer_cast<GPA_OpenContextPtrType> (LoadFunction (lib, "GPA_OpenContext"));
+	table.selectContext			= function_pointer_cast<GPA_SelectContextPtrType>(LoadFunction (lib, "GPA_SelectContext"));
+	table.closeContext 			= function_pointer_cast<GPA_CloseContextPtrType> (LoadFunction (lib, "GPA_CloseContext"));
+	table.getNumCounters 		= function_pointer_cast<GPA_GetNumCountersPtrType> (LoadFunction (lib, "GPA_GetNumCounters"));
+	table.getCounterName 		= function_pointer_cast<GPA_GetCounterNamePtrType> (LoadFunction (lib, "GPA_GetCounterName"));
+	table.getCounterDataType 	= function_pointer_cast<GPA_GetCounterDataTypePtrType> (LoadFunction (lib, "GPA_GetCounterDataType"));
+	table.getCounterUsageType	= function_pointer_cast<GPA_GetCounterUsageTypePtrType> (LoadFunction (lib, "GPA_GetCounterUsageType"));
+	table.enableCounter 		= function_pointer_cast<GPA_EnableCounterPtrType> (LoadFunction (lib, "GPA_EnableCounter"));
+	table.disableCounter 		= function_pointer_cast<GPA_DisableCounterPtrType> (LoadFunction (lib, "GPA_DisableCounter"));
+	table.getPassCount 			= function_pointer_cast<GPA_GetPassCountPtrType> (LoadFunction (lib, "GPA_GetPassCount"));
+	table.beginSession 			= function_pointer_cast<GPA_BeginSessionPtrType> (LoadFunction (lib, "GPA_BeginSession"));
+	table.endSession 			= function_pointer_cast<GPA_EndSessionPtrType> (LoadFunction (lib, "GPA_EndSession"));
+	table.beginPass 			= function_pointer_cast<GPA_BeginPassPtrType> (LoadFunction (lib, "GPA_BeginPass"));
+	table.endPass 				= function_pointer_cast<GPA_EndPassPtrType> (LoadFunction (lib, "GPA_EndPass"));
+	table.beginSample 			= function_pointer_cast<GPA_BeginSamplePtrType> (LoadFunction (lib, "GPA_BeginSample"));
+	table.endSample 			= function_pointer_cast<GPA_EndSamplePtrType> (LoadFunction (lib, "GPA_EndSample"));
+	table.isSessionReady 		= function_pointer_cast<GPA_IsSessionReadyPtrType> (LoadFunction (lib, "GPA_IsSessionReady"));
+	table.getSampleUInt64 		= function_pointer_cast<GPA_GetSampleUInt64PtrType> (LoadFunction (lib, "GPA_GetSampleUInt64"));
+	table.getSampleUInt32 		= function_pointer_cast<GPA_GetSampleUInt32PtrType> (LoadFunction (lib, "GPA_GetSampleUInt32"));
+	table.getSampleFloat32 		= function_pointer_cast<GPA_GetSampleFloat32PtrType> (LoadFunction (lib, "GPA_GetSampleFloat32"));
+	table.getSampleFloat64 		= function_pointer_cast<GPA_GetSampleFloat64PtrType> (LoadFunction (lib, "GPA_GetSampleFloat64"));
+	table.getEnabledCount 		= function_pointer_cast<GPA_GetEnabledCountPtrType> (LoadFunction (lib, "GPA_GetEnabledCount"));
+	table.getEnabledIndex 		= function_pointer_cast<GPA_GetEnabledIndexPtrType> (LoadFunction (lib, "GPA_GetEnabledIndex"));
+}
+
+std::string GetErrorMessage (const int error)
+{
+	switch (error) {
+	case ErrorCode::UnknownDataType:	return "Unknown data type.";
+	case ErrorCode::UnknownUsageType:	return "Unknown usage type.";
+	case ErrorCode::InvalidObject:		return "Invalid object.";
+	case ErrorCode::ErrorLogOverflow:	return "Error log overflow.";
+	default:							return "GPA error: " + std::to_string (error);
+	}
+}
+
+const std::shared_ptr<const CounterSet::CounterMap>& GetEmptyCounterMap ()
+{
+	static const std::shared_ptr<const CounterSet::CounterMap> empty =
+		std::make_shared<CounterSet::CounterMap> ();
+	return empty;
+}
 }
 
 /////////////////////////////////////////////////////////////////////////////
 Exception::Exception (const int error)
-: std::runtime_error ("GPA error: " + std::to_string (error))
+: std::runtime_error (GetErrorMessage (error))
 , errorCode_ (error)
 {
 }
@@ -70,87 +134,53 @@ int Exception::GetErrorCode () const
 	return errorCode_;
 }
 
-namespace Internal {
-struct ImportTable
+/////////////////////////////////////////////////////////////////////////////
+double ToDouble (const ResultEntry& entry)
+{
+	switch (entry.dataType) {
+	case DataType::float32:	return static_cast<double> (entry.f32);
+	case DataType::float64:	return entry.f64;
+	case DataType::uint32:	return static_cast<double> (entry.u32);
+	case DataType::uint64:	return static_cast<double> (entry.u64);
+	case DataType::int32:	return static_cast<double> (entry.i32);
+	case DataType::int64:	return static_cast<double> (entry.i64);
+	}
+
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+SessionListener::~SessionListener ()
 {
-	static void LoadFunctions (LibraryHandle lib, ImportTable& table)
-	{
-		table.initialize 			= function_pointer_cast<GPA_InitializePtrType> (LoadFunction (lib, "GPA_Initialize"));
-		table.destroy 				= function_pointer_cast<GPA_DestroyPtrType> (LoadFunction (lib, "GPA_Destroy"));
-		table.openContext 			= function_pointer_cast<GPA_OpenContextPtrType> (LoadFunction (lib, "GPA_OpenContext"));
-		table.selectContext			= function_pointer_cast<GPA_SelectContextPtrType>(LoadFunction (lib, "GPA_SelectContext"));
-		table.closeContext 			= function_pointer_cast<GPA_CloseContextPtrType> (LoadFunction (lib, "GPA_CloseContext"));
-		table.getNumCounters 		= function_pointer_cast<GPA_GetNumCountersPtrType> (LoadFunction (lib, "GPA_GetNumCounters"));
-		table.getCounterName 		= function_pointer_cast<GPA_GetCounterNamePtrType> (LoadFunction (lib, "GPA_GetCounterName"));
-		table.getCounterDataType 	= function_pointer_cast<GPA_GetCounterDataTypePtrType> (LoadFunction (lib, "GPA_GetCounterDataType"));
-		table.getCounterUsageType	= function_pointer_cast<GPA_GetCounterUsageTypePtrType> (LoadFunction (lib, "GPA_GetCounterUsageType"));
-		table.enableCounter 		= function_pointer_cast<GPA_EnableCounterPtrType> (LoadFunction (lib, "GPA_EnableCounter"));
-		table.disableCounter 		= function_pointer_cast<GPA_DisableCounterPtrType> (LoadFunction (lib, "GPA_DisableCounter"));
-		table.getPassCount 			= function_pointer_cast<GPA_GetPassCountPtrType> (LoadFunction (lib, "GPA_GetPassCount"));
-		table.beginSession 			= function_pointer_cast<GPA_BeginSessionPtrType> (LoadFunction (lib, "GPA_BeginSession"));
-		table.endSession 			= function_pointer_cast<GPA_EndSessionPtrType> (LoadFunction (lib, "GPA_EndSession"));
-		table.beginPass 			= function_pointer_cast<GPA_BeginPassPtrType> (LoadFunction (lib, "GPA_BeginPass"));
-		table.endPass 				= function_pointer_cast<GPA_EndPassPtrType> (LoadFunction (lib, "GPA_EndPass"));
-		table.beginSample 			= function_pointer_cast<GPA_BeginSamplePtrType> (LoadFunction (lib, "GPA_BeginSample"));
-		table.endSample 			= function_pointer_cast<GPA_EndSamplePtrType> (LoadFunction (lib, "GPA_EndSample"));
-		table.isSessionReady 		= function_pointer_cast<GPA_IsSessionReadyPtrType> (LoadFunction (lib, "GPA_IsSessionReady"));
-		table.getSampleUInt64 		= function_pointer_cast<GPA_GetSampleUInt64PtrType> (LoadFunction (lib, "GPA_GetSampleUInt64"));
-		table.getSampleUInt32 		= function_pointer_cast<GPA_GetSampleUInt32PtrType> (LoadFunction (lib, "GPA_GetSampleUInt32"));
-		table.getSampleFloat32 		= function_pointer_cast<GPA_GetSampleFloat32PtrType> (LoadFunction (lib, "GPA_GetSampleFloat32"));
-		table.getSampleFloat64 		= function_pointer_cast<GPA_GetSampleFloat64PtrType> (LoadFunction (lib, "GPA_GetSampleFloat64"));
-		table.getEnabledCount 		= function_pointer_cast<GPA_GetEnabledCountPtrType> (LoadFunction (lib, "GPA_GetEnabledCount"));
-		table.getEnabledIndex 		= function_pointer_cast<GPA_GetEnabledIndexPtrType> (LoadFunction (lib, "GPA_GetEnabledIndex"));
-	}
-
-	GPA_InitializePtrType 			initialize;
-	GPA_DestroyPtrType 				destroy;
-
-	GPA_OpenContextPtrType			openContext;
-	GPA_SelectContextPtrType		selectContext;
-	GPA_CloseContextPtrType			closeContext;
-
-	GPA_GetNumCountersPtrType		getNumCounters;
-	GPA_GetCounterNamePtrType		getCounterName;
-	GPA_GetCounterDataTypePtrType	getCounterDataType;
-	GPA_GetCounterUsageTypePtrType  getCounterUsageType;
-
-	GPA_EnableCounterPtrType		enableCounter;
-	GPA_DisableCounterPtrType		disableCounter;
-
-	GPA_GetPassCountPtrType 		getPassCount;
-
-	GPA_BeginSessionPtrType 		beginSession;
-	GPA_EndSessionPtrType 			endSession;
-
-	GPA_BeginPassPtrType 			beginPass;
-	GPA_EndPassPtrType 				endPass;
-
-	GPA_BeginSamplePtrType 			beginSample;
-	GPA_EndSamplePtrType 			endSample;
-
-	GPA_GetEnabledCountPtrType		getEnabledCount;
-	GPA_GetEnabledIndexPtrType		getEnabledIndex;
-
-	GPA_IsSessionReadyPtrType 		isSessionReady;
-	GPA_GetSampleUInt64PtrType 		getSampleUInt64;
-	GPA_GetSampleUInt32PtrType 		getSampleUInt32;
-	GPA_GetSampleFloat32PtrType 	getSampleFloat32;
-	GPA_GetSampleFloat64PtrType 	getSampleFloat64;
-};
 }
 
 struct PerformanceLibrary::Impl
 {
-	Impl (const ProfileApi::Enum api)
+	Impl (const ProfileApi::Enum api, const LibraryMode::Enum mode,
+		const std::string& logFile)
 	: lib_ (nullptr)
+	, mode_ (mode)
+	, logActive_ (false)
 	{
+		::memset (&imports_, 0, sizeof (imports_));
+
+		if (mode_ == LibraryMode::Replay) {
+			Internal::BeginReplay (imports_, logFile, api);
+			logActive_ = true;
+
+			UnloadGuard guard = { this };
+			Initialize ();
+			guard.impl = nullptr;
+			return;
+		}
+
 #if AMD_PERF_API_LINUX
 		switch (api) {
 		case ProfileApi::OpenCL: lib_ = dlopen ("libGPUPerfAPICL.so", RTLD_NOW); break;
 		case ProfileApi::OpenGL: lib_ = dlopen ("libGPUPerfAPIGL.so", RTLD_NOW); break;
 		case ProfileApi::OpenGLES: lib_ = dlopen ("libGPUPerfAPIGLES.so", RTLD_NOW); break;
 		default:
-			throw std::runtime_error ("Unsupported API");
+			NIV_THROW (std::runtime_error ("Unsupported API"));
 		}
 
 #elif AMD_PERF_API_WINDOWS
@@ -172,22 +202,52 @@ struct PerformanceLibrary::Impl
 #endif
 
 		if (lib_ == nullptr) {
-			throw std::runtime_error ("Failed to initialize performance API library.");
+			NIV_THROW (std::runtime_error ("Failed to initialize performance API library."));
 		}
-		
-		::memset (&imports_, 0, sizeof (imports_));
+
+		// Unload again if anything below throws
+		UnloadGuard guard = { this };
 
 		// Get the import functions
-		Internal::ImportTable::LoadFunctions (lib_, imports_);
-		
-		// Initialize the API
-		NIV_SAFE_GPA (imports_.initialize ());
+		LoadImportTable (lib_, imports_);
+
+		if (mode_ == LibraryMode::Record) {
+			Internal::BeginRecording (imports_, logFile, api);
+			logActive_ = true;
+		}
+
+		Initialize ();
+
+		guard.impl = nullptr;
 	}
 
 	~Impl ()
 	{
-		// Cannot use NIV_SAFE_GPA as it may throw, assume this succeeds
-		imports_.destroy ();
+		imports_.Check (imports_.destroy (), "GPA_Destroy");
+
+		Unload ();
+	}
+
+	void Initialize ()
+	{
+		const auto status = imports_.initialize ();
+
+		if (status != GPA_STATUS_OK) {
+			NIV_THROW (Exception (status));
+		}
+	}
+
+	void Unload ()
+	{
+		if (logActive_) {
+			switch (mode_) {
+			case LibraryMode::Record:	Internal::EndRecording (imports_); break;
+			case LibraryMode::Replay:	Internal::EndReplay (imports_); break;
+			default: break;
+			}
+
+			logActive_ = false;
+		}
 
 #if AMD_PERF_API_LINUX
 		if (lib_ != nullptr) {
@@ -198,6 +258,7 @@ struct PerformanceLibrary::Impl
 			FreeLibrary (lib_);
 		}
 #endif
+		lib_ = nullptr;
 	}
 	
 	Context OpenContext (void* ctx)
@@ -205,16 +266,49 @@ struct PerformanceLibrary::Impl
 		return Context (&imports_, ctx);
 	}
 
+	void SetListener (SessionListener* listener)
+	{
+		imports_.listener = listener;
+	}
+
+	Internal::ImportTable* GetImports ()
+	{
+		return &imports_;
+	}
+
 private:
+	struct UnloadGuard
+	{
+		~UnloadGuard ()
+		{
+			if (impl) {
+				impl->Unload ();
+			}
+		}
+
+		Impl* impl;
+	};
+
 	Internal::ImportTable	imports_;
 	LibraryHandle			lib_;
+	LibraryMode::Enum		mode_;
+	bool					logActive_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 CounterSet::CounterSet (Internal::ImportTable* importTable, 
 	const CounterSet::CounterMap& counters)
 : imports_ (importTable)
-, counters_ (counters)
+, counters_ (std::make_shared<CounterMap> (counters))
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CounterSet::CounterSet (Internal::ImportTable* importTable, 
+	const std::shared_ptr<const CounterSet::CounterMap>& counters)
+: imports_ (importTable)
+, counters_ (counters ? counters : GetEmptyCounterMap ())
 {
 
 }
@@ -222,6 +316,7 @@ CounterSet::CounterSet (Internal::ImportTable* importTable,
 ////////////////////////////////////////////////////////////////////////////////
 CounterSet::CounterSet ()
 : imports_ (nullptr)
+, counters_ (GetEmptyCounterMap ())
 {
 
 }
@@ -229,111 +324,182 @@ CounterSet::CounterSet ()
 ////////////////////////////////////////////////////////////////////////////////
 CounterSet::CounterMap::const_iterator CounterSet::begin () const
 {
-	return counters_.begin ();
+	return counters_->begin ();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CounterSet::CounterMap::const_iterator CounterSet::end () const
 {
-	return counters_.end ();
+	return counters_->end ();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CounterSet::CounterMap::const_iterator CounterSet::cbegin () const
 {
-	return counters_.cbegin ();
+	return counters_->cbegin ();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CounterSet::CounterMap::const_iterator CounterSet::cend () const
 {
-	return counters_.cend ();
+	return counters_->cend ();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 const Counter& CounterSet::operator [] (const std::string& name) const
 {
-	auto it = counters_.find (name);
+	const Counter* counter = Find (name);
+
+	if (counter == nullptr) {
+		NIV_THROW (std::runtime_error ("Invalid key"));
+	} else {
+		return *counter;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Counter* CounterSet::Find (const std::string& name) const noexcept
+{
+	auto it = counters_->find (name);
 
-	if (it == counters_.end ()) {
-		throw std::runtime_error ("Invalid key");
+	if (it == counters_->end ()) {
+		return nullptr;
 	} else {
-		return it->second;
+		return &it->second;
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 int CounterSet::GetRequiredPassCount () const
 {
-	std::uint32_t passCount = 0;
+	int passCount = 0;
 
-	NIV_SAFE_GPA (imports_->getPassCount (&passCount));
+	NIV_SAFE_GPA (TryGetRequiredPassCount (passCount));
 
-	return static_cast<int> (passCount);
+	return passCount;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CounterSet::Enable ()
 {
-	for (const auto& kv : counters_) {
-		NIV_SAFE_GPA (imports_->enableCounter (kv.second.index));
-	}
+	NIV_SAFE_GPA (TryEnable ());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CounterSet::Disable ()
 {
-	for (const auto& kv : counters_) {
-		NIV_SAFE_GPA (imports_->disableCounter (kv.second.index));
+	NIV_SAFE_GPA (TryDisable ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CounterSet::TryGetRequiredPassCount (int& passCount) const noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	gpa_uint32 count = 0;
+	const int status = imports_->Check (imports_->getPassCount (&count), "GPA_GetPassCount");
+
+	if (status == GPA_STATUS_OK) {
+		passCount = static_cast<int> (count);
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CounterSet::TryEnable () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	for (const auto& kv : *counters_) {
+		const int status = imports_->Check (imports_->enableCounter (kv.second.index), "GPA_EnableCounter");
+
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
+	}
+
+	return GPA_STATUS_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CounterSet::TryDisable () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
 	}
+
+	for (const auto& kv : *counters_) {
+		const int status = imports_->Check (imports_->disableCounter (kv.second.index), "GPA_DisableCounter");
+
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
+	}
+
+	return GPA_STATUS_OK;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CounterSet::Keep (const std::vector<std::string>& counters)
 {
-	std::set<std::string> counterSet (counters.begin (), counters.end ());
+	// Other copies may share the map, so build a new one instead of erasing
+	auto result = std::make_shared<CounterMap> ();
 	
-	auto it = counters_.begin (), end = counters_.end ();
+	for (const auto& name : counters) {
+		auto it = counters_->find (name);
 
-	while (it != end) {
-		if (counterSet.find (it->first) == counterSet.end ()) {
-			it = counters_.erase (it);
-		} else {
-			++it;
+		if (it != counters_->end ()) {
+			result->insert (*it);
 		}
 	}
+
+	counters_ = std::move (result);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 Sample::Sample (Internal::ImportTable* importTable, std::uint32_t id)
 : imports_ (importTable)
+, id_ (id)
+, active_ (false)
+{
+	NIV_SAFE_GPA (Begin ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Sample::Sample ()
+: imports_ (nullptr)
+, id_ (0)
 , active_ (false)
 {
-	NIV_SAFE_GPA (imports_->beginSample (id));
-	active_ = true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 Sample::~Sample ()
 {
 	if (active_) {
-		// Cannot use NIV_SAFE_GPA as it may throw, assume this succeeds
-		imports_->endSample ();
+		imports_->Check (Finish (), "GPA_EndSample");
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Sample::Sample (Sample&& other)
+Sample::Sample (Sample&& other) noexcept
 : imports_ (other.imports_)
+, id_ (other.id_)
 , active_ (other.active_)
 {
 	other.active_ = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Sample& Sample::operator= (Sample&& other)
+Sample& Sample::operator= (Sample&& other) noexcept
 {
 	imports_ 		= other.imports_;
+	id_				= other.id_;
 	active_ 		= other.active_;
 	other.active_ 	= false;
 	
@@ -343,8 +509,59 @@ Sample& Sample::operator= (Sample&& other)
 ////////////////////////////////////////////////////////////////////////////////
 void Sample::End ()
 {
-	NIV_SAFE_GPA (imports_->endSample ());
-	active_ = false;
+	NIV_SAFE_GPA (Finish ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Sample::TryEnd () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (Finish (), "GPA_EndSample");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Sample::IsActive () const noexcept
+{
+	return active_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Sample::Begin () noexcept
+{
+	const int status = imports_->beginSample (id_);
+
+	if (status == GPA_STATUS_OK) {
+		active_ = true;
+
+		if (imports_->listener) {
+			imports_->listener->OnBeginSample (id_);
+		}
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Sample::Finish () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	const int status = imports_->endSample ();
+
+	if (status == GPA_STATUS_OK) {
+		active_ = false;
+
+		if (imports_->listener) {
+			imports_->listener->OnEndSample (id_);
+		}
+	}
+
+	return status;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -352,21 +569,26 @@ Pass::Pass (Internal::ImportTable* importTable)
 : imports_ (importTable)
 , active_ (false)
 {
-	NIV_SAFE_GPA (imports_->beginPass ());
-	active_ = true;
+	NIV_SAFE_GPA (Begin ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Pass::Pass ()
+: imports_ (nullptr)
+, active_ (false)
+{
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 Pass::~Pass ()
 {
 	if (active_) {
-		// Cannot use NIV_SAFE_GPA as it may throw, assume this succeeds
-		imports_->endPass ();
+		imports_->Check (Finish (), "GPA_EndPass");
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Pass::Pass (Pass&& other)
+Pass::Pass (Pass&& other) noexcept
 : imports_ (other.imports_)
 , active_ (other.active_)
 {
@@ -374,7 +596,7 @@ Pass::Pass (Pass&& other)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Pass& Pass::operator= (Pass&& other)
+Pass& Pass::operator= (Pass&& other) noexcept
 {
 	imports_ = other.imports_;
 	active_ = other.active_;
@@ -386,8 +608,23 @@ Pass& Pass::operator= (Pass&& other)
 ////////////////////////////////////////////////////////////////////////////////
 void Pass::End ()
 {
-	NIV_SAFE_GPA (imports_->endPass ());
-	active_ = false;
+	NIV_SAFE_GPA (Finish ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Pass::TryEnd () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (Finish (), "GPA_EndPass");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Pass::IsActive () const noexcept
+{
+	return active_;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -402,27 +639,89 @@ Sample Pass::BeginSample (const std::uint32_t id)
 	return Sample (imports_, id);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+int Pass::TryBeginSample (const std::uint32_t id, Sample& sample) noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	Sample result;
+	result.imports_ = imports_;
+	result.id_ = id;
+
+	const int status = imports_->Check (result.Begin (), "GPA_BeginSample");
+
+	if (status == GPA_STATUS_OK) {
+		sample = std::move (result);
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Pass::Begin () noexcept
+{
+	const int status = imports_->beginPass ();
+
+	if (status == GPA_STATUS_OK) {
+		active_ = true;
+
+		if (imports_->listener) {
+			imports_->listener->OnBeginPass ();
+		}
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Pass::Finish () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	const int status = imports_->endPass ();
+
+	if (status == GPA_STATUS_OK) {
+		active_ = false;
+
+		if (imports_->listener) {
+			imports_->listener->OnEndPass ();
+		}
+	}
+
+	return status;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 Session::Session (Internal::ImportTable* importTable)
 : imports_ (importTable)
 , id_ (0)
 , active_ (false)
 {
-	NIV_SAFE_GPA (imports_->beginSession (&id_));
-	active_ = true;
+	NIV_SAFE_GPA (Begin ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Session::Session ()
+: imports_ (nullptr)
+, id_ (0)
+, active_ (false)
+{
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 Session::~Session()
 {
 	if (active_) {
-		// Cannot use NIV_SAFE_GPA as it may throw, assume this succeeds
-		imports_->endSession ();
+		imports_->Check (Finish (), "GPA_EndSession");
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Session::Session (Session&& other)
+Session::Session (Session&& other) noexcept
 : imports_ (other.imports_)
 , id_ (other.id_)
 , active_ (other.active_)
@@ -431,7 +730,7 @@ Session::Session (Session&& other)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Session& Session::operator= (Session&& other)
+Session& Session::operator= (Session&& other) noexcept
 {
 	imports_ 		= other.imports_;
 	id_ 			= other.id_;
@@ -450,8 +749,7 @@ Pass Session::BeginPass ()
 ////////////////////////////////////////////////////////////////////////////////
 void Session::End ()
 {
-	NIV_SAFE_GPA (imports_->endSession ());
-	active_ = false;
+	NIV_SAFE_GPA (Finish ());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -472,36 +770,201 @@ SessionResult Session::GetResult () const
 
 ////////////////////////////////////////////////////////////////////////////////
 SessionResult Session::GetResult (const bool block) const
+{
+	return GetSampleResult (0, block);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SessionResult Session::GetSampleResult (const std::uint32_t sampleId, 
+	const bool block) const
 {
 	SessionResult result;
 
-	bool ready = IsReady ();
+	NIV_SAFE_GPA (ReadResult (sampleId, block, result));
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FrameResult Session::GetSampleResult (const std::uint32_t sampleId, 
+	const bool block, MemoryResource* resource) const
+{
+	FrameResult result (resource);
+
+	NIV_SAFE_GPA (ReadResult (sampleId, block, result));
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::TryBeginPass (Pass& pass) noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	Pass result;
+	result.imports_ = imports_;
+
+	const int status = imports_->Check (result.Begin (), "GPA_BeginPass");
+
+	if (status == GPA_STATUS_OK) {
+		pass = std::move (result);
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::TryEnd () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (Finish (), "GPA_EndSession");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Session::IsActive () const noexcept
+{
+	return active_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::TryIsReady (bool& ready) const noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (imports_->isSessionReady (&ready, id_), "GPA_IsSessionReady");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::TryGetResult (const bool block, SessionResult& result) const noexcept
+{
+	return TryGetSampleResult (0, block, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::TryGetSampleResult (const std::uint32_t sampleId, const bool block,
+	SessionResult& result) const noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (ReadResult (sampleId, block, result), "GetSampleResult");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::TryGetSampleResult (const std::uint32_t sampleId, const bool block,
+	FrameResult& result) const noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (ReadResult (sampleId, block, result), "GetSampleResult");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::Begin () noexcept
+{
+	const int status = imports_->beginSession (&id_);
+
+	if (status == GPA_STATUS_OK) {
+		active_ = true;
+
+		if (imports_->listener) {
+			imports_->listener->OnBeginSession (id_);
+		}
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Session::Finish () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	const int status = imports_->endSession ();
+
+	if (status == GPA_STATUS_OK) {
+		active_ = false;
+
+		if (imports_->listener) {
+			imports_->listener->OnEndSession (id_);
+		}
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <typename Result>
+int Session::ReadResult (const std::uint32_t sampleId, const bool block,
+	Result& result) const noexcept
+{
+	result.clear ();
+
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	bool ready = false;
+	int status = imports_->isSessionReady (&ready, id_);
+
+	if (status != GPA_STATUS_OK) {
+		return status;
+	}
 
 	if (!block && !ready) {
 		// Not ready and we don't block to get results, return empty result
-		return result;
+		return GPA_STATUS_OK;
 	} else if (block && !ready) {
 		// Not ready and we block to get results, loop until ready
-		while (!IsReady ()) { 
-			/* Wait */ 
+		while (!ready) { 
+			status = imports_->isSessionReady (&ready, id_);
+
+			if (status != GPA_STATUS_OK) {
+				return status;
+			}
 		}
 		
 		// Will be ready at this point
 	} // else, ready, go ahead and fetch results
 	
 	gpa_uint32 enabledCounterCount = 0;
-	NIV_SAFE_GPA (imports_->getEnabledCount (&enabledCounterCount));
+	status = imports_->getEnabledCount (&enabledCounterCount);
+
+	if (status != GPA_STATUS_OK) {
+		return status;
+	}
 
 	for (gpa_uint32 i = 0; i < enabledCounterCount; ++i) {
 		gpa_uint32 index = 0;
 
-		NIV_SAFE_GPA (imports_->getEnabledIndex (i, &index));
-		const char* name = nullptr;
+		status = imports_->getEnabledIndex (i, &index);
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
 
-		NIV_SAFE_GPA (imports_->getCounterName (index, &name));
+		const char* name = nullptr;
+		status = imports_->getCounterName (index, &name);
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
 
 		GPA_Type type;
-		NIV_SAFE_GPA (imports_->getCounterDataType (index, &type));
+		status = imports_->getCounterDataType (index, &type);
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
 
 		ResultEntry resultEntry;
 
@@ -509,7 +972,7 @@ SessionResult Session::GetResult (const bool block) const
 			case GPA_TYPE_INT32:
 			{
 				gpa_uint32 value;
-				NIV_SAFE_GPA (imports_->getSampleUInt32 (id_, 0, index, &value));
+				status = imports_->getSampleUInt32 (id_, sampleId, index, &value);
 				resultEntry.i32 = static_cast<std::int32_t> (value);
 				resultEntry.dataType = DataType::int32;
 				break;
@@ -517,7 +980,7 @@ SessionResult Session::GetResult (const bool block) const
 			case GPA_TYPE_INT64:
 			{
 				gpa_uint64 value;
-				NIV_SAFE_GPA (imports_->getSampleUInt64 (id_, 0, index, &value));
+				status = imports_->getSampleUInt64 (id_, sampleId, index, &value);
 				resultEntry.i64 = static_cast<std::int64_t> (value);
 				resultEntry.dataType = DataType::int64;
 				break;
@@ -525,7 +988,7 @@ SessionResult Session::GetResult (const bool block) const
 			case GPA_TYPE_UINT32:
 			{
 				gpa_uint32 value;
-				NIV_SAFE_GPA (imports_->getSampleUInt32 (id_, 0, index, &value));
+				status = imports_->getSampleUInt32 (id_, sampleId, index, &value);
 				resultEntry.u32 = value;
 				resultEntry.dataType = DataType::uint32;
 				break;
@@ -533,7 +996,7 @@ SessionResult Session::GetResult (const bool block) const
 			case GPA_TYPE_UINT64:
 			{
 				gpa_uint64 value;
-				NIV_SAFE_GPA (imports_->getSampleUInt64 (id_, 0, index, &value));
+				status = imports_->getSampleUInt64 (id_, sampleId, index, &value);
 				resultEntry.u64 = value;
 				resultEntry.dataType = DataType::uint64;
 				break;
@@ -541,7 +1004,7 @@ SessionResult Session::GetResult (const bool block) const
 			case GPA_TYPE_FLOAT32:
 			{
 				gpa_float32 value;
-				NIV_SAFE_GPA (imports_->getSampleFloat32 (id_, 0, index, &value));
+				status = imports_->getSampleFloat32 (id_, sampleId, index, &value);
 				resultEntry.f32 = value;
 				resultEntry.dataType = DataType::float32;
 				break;
@@ -549,25 +1012,42 @@ SessionResult Session::GetResult (const bool block) const
 			case GPA_TYPE_FLOAT64:
 			{
 				gpa_float64 value;
-				NIV_SAFE_GPA (imports_->getSampleFloat64 (id_, 0, index, &value));
+				status = imports_->getSampleFloat64 (id_, sampleId, index, &value);
 				resultEntry.f64 = value;
 				resultEntry.dataType = DataType::float64;
 				break;
 			}
 
 			default:
-				throw std::runtime_error ("Unsupported data type.");
+				return ErrorCode::UnknownDataType;
 		}
 
-		result.emplace (name, resultEntry);
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
+
+		result.emplace (std::piecewise_construct,
+			std::forward_as_tuple (name, result.get_allocator ()),
+			std::forward_as_tuple (resultEntry));
 	}
 
-	return result;
+	if (imports_->listener) {
+		NotifyResult (*imports_->listener, id_, sampleId, result);
+	}
+
+	return GPA_STATUS_OK;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 PerformanceLibrary::PerformanceLibrary (const ProfileApi::Enum targetApi)
-: impl_ (new Impl (targetApi))
+: impl_ (new Impl (targetApi, LibraryMode::Live, std::string ()))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+PerformanceLibrary::PerformanceLibrary (const ProfileApi::Enum targetApi,
+	const LibraryMode::Enum mode, const std::string& logFile)
+: impl_ (new Impl (targetApi, mode, logFile))
 {
 }
 
@@ -583,12 +1063,33 @@ Context PerformanceLibrary::OpenContext (void* ctx)
 	return impl_->OpenContext (ctx);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+int PerformanceLibrary::TryOpenContext (void* ctx, Context& context) noexcept
+{
+	Context result;
+	result.imports_ = impl_->GetImports ();
+
+	const int status = result.imports_->Check (result.Open (ctx), "GPA_OpenContext");
+
+	if (status == GPA_STATUS_OK) {
+		context = std::move (result);
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PerformanceLibrary::SetListener (SessionListener* listener)
+{
+	impl_->SetListener (listener);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 Context::Context (Internal::ImportTable* imports, void* ctx)
 : imports_ (imports)
-, context_ (ctx)
+, context_ (nullptr)
 {
-	NIV_SAFE_GPA (imports_->openContext (ctx));
+	NIV_SAFE_GPA (Open (ctx));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -602,23 +1103,25 @@ Context::Context ()
 Context::~Context()
 {
 	if (context_) {
-		Close ();
+		imports_->Check (Shutdown (), "GPA_CloseContext");
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Context::Context (Context&& other)
+Context::Context (Context&& other) noexcept
 : imports_ (other.imports_)
 , context_ (other.context_)
+, catalogue_ (std::move (other.catalogue_))
 {
 	other.context_ = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Context& Context::operator= (Context&& other)
+Context& Context::operator= (Context&& other) noexcept
 {
 	imports_ = other.imports_;
 	context_ = other.context_;
+	catalogue_ = std::move (other.catalogue_);
 	other.context_ = nullptr;
 
 	return *this;
@@ -627,20 +1130,60 @@ Context& Context::operator= (Context&& other)
 ////////////////////////////////////////////////////////////////////////////////
 CounterSet Context::GetAvailableCounters () const
 {
-	CounterSet::CounterMap result;
+	std::shared_ptr<const CounterSet::CounterMap> result;
+
+	NIV_SAFE_GPA (GetCatalogue (result));
 	
+	return CounterSet (imports_, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::GetCatalogue (std::shared_ptr<const CounterSet::CounterMap>& counters) const noexcept
+{
+	if (catalogue_ == nullptr) {
+		auto catalogue = std::make_shared<CounterSet::CounterMap> ();
+		const int status = ReadCounters (*catalogue);
+
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
+
+		catalogue_ = std::move (catalogue);
+	}
+
+	counters = catalogue_;
+
+	return GPA_STATUS_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::ReadCounters (CounterSet::CounterMap& result) const noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
 	gpa_uint32 availableCounters = 0;
-	NIV_SAFE_GPA (imports_->getNumCounters (&availableCounters));
+	int status = imports_->getNumCounters (&availableCounters);
+
+	if (status != GPA_STATUS_OK) {
+		return status;
+	}
 
 	for (gpa_uint32 i = 0; i < availableCounters; ++i) {
 		Counter counter;
 
 		const char* name = nullptr;
-		NIV_SAFE_GPA (imports_->getCounterName (i, &name));
+		status = imports_->getCounterName (i, &name);
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
 
 		GPA_Type dataType;
-
-		NIV_SAFE_GPA (imports_->getCounterDataType (i, &dataType));
+		status = imports_->getCounterDataType (i, &dataType);
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
 
 		switch (dataType) {
 			case GPA_TYPE_UINT32:	counter.type = DataType::uint32; break;
@@ -651,12 +1194,14 @@ CounterSet Context::GetAvailableCounters () const
 			case GPA_TYPE_INT64:	counter.type = DataType::int64; break;
 
 			default:
-				throw std::runtime_error ("Unknown data type.");
+				return ErrorCode::UnknownDataType;
 		}
 
 		GPA_Usage_Type usageType;
-
-		NIV_SAFE_GPA (imports_->getCounterUsageType (i, &usageType));
+		status = imports_->getCounterUsageType (i, &usageType);
+		if (status != GPA_STATUS_OK) {
+			return status;
+		}
 
 		switch (usageType) {
 		case GPA_USAGE_TYPE_RATIO:			counter.usage = UsageType::Ratio; break;
@@ -668,7 +1213,7 @@ CounterSet Context::GetAvailableCounters () const
 		case GPA_USAGE_TYPE_KILOBYTES:		counter.usage = UsageType::Kilobytes; break;
 		
 		default:
-			throw std::runtime_error ("Unknown usage type.");
+			return ErrorCode::UnknownUsageType;
 		}
 
 		counter.index = i;
@@ -676,21 +1221,19 @@ CounterSet Context::GetAvailableCounters () const
 		result [name] = counter;
 	}
 	
-	return CounterSet (imports_, result);
+	return GPA_STATUS_OK;
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////
 void Context::Select ()
 {
-	NIV_SAFE_GPA (imports_->selectContext (context_));
+	NIV_SAFE_GPA (TrySelect ());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void Context::Close ()
 {
-	NIV_SAFE_GPA (imports_->closeContext ());
-	context_ = nullptr;
+	NIV_SAFE_GPA (Shutdown ());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -698,4 +1241,119 @@ Session Context::BeginSession()
 {
 	return Session (imports_);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::TrySelect () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (imports_->selectContext (context_), "GPA_SelectContext");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::TryClose () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	return imports_->Check (Shutdown (), "GPA_CloseContext");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::TryGetAvailableCounters (CounterSet& counters) const noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	std::shared_ptr<const CounterSet::CounterMap> result;
+	const int status = imports_->Check (GetCatalogue (result), "GetAvailableCounters");
+
+	if (status == GPA_STATUS_OK) {
+		counters = CounterSet (imports_, result);
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::TryBeginSession (Session& session) noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	Session result;
+	result.imports_ = imports_;
+
+	const int status = imports_->Check (result.Begin (), "GPA_BeginSession");
+
+	if (status == GPA_STATUS_OK) {
+		session = std::move (result);
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t Context::DrainErrors (ErrorRecord* errors, const std::size_t capacity) noexcept
+{
+	if (imports_ == nullptr) {
+		return 0;
+	}
+
+	auto& log = imports_->errors;
+	std::size_t count = 0;
+
+	while (count < capacity && count < log.count) {
+		errors [count] = log.records [count];
+		++count;
+	}
+
+	// Keep what did not fit for the next call
+	std::copy (log.records + count, log.records + log.count, log.records);
+	log.count -= count;
+
+	if (log.count == 0 && log.overflow && count < capacity) {
+		errors [count].code = ErrorCode::ErrorLogOverflow;
+		errors [count].operation = "DrainErrors";
+		++count;
+
+		log.overflow = false;
+	}
+
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::Open (void* ctx) noexcept
+{
+	const int status = imports_->openContext (ctx);
+
+	if (status == GPA_STATUS_OK) {
+		context_ = ctx;
+	}
+
+	return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Context::Shutdown () noexcept
+{
+	if (imports_ == nullptr) {
+		return ErrorCode::InvalidObject;
+	}
+
+	const int status = imports_->closeContext ();
+
+	if (status == GPA_STATUS_OK) {
+		context_ = nullptr;
+		catalogue_.reset ();
+	}
+
+	return status;
+}
 }
@@ -4,8 +4,12 @@
 #include <string>
 #include <cstdint>
 #include <map>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
+#include "Memory.h"
+
 namespace Amd {
 struct DataType
 {
@@ -45,6 +49,16 @@ struct ProfileApi
 	};
 };
 
+struct LibraryMode
+{
+	enum Enum
+	{
+		Live,		///< Call into GPUPerfAPI
+		Record,		///< Call into GPUPerfAPI and log all calls to a file
+		Replay		///< Serve all calls from a log file, without a GPU
+	};
+};
+
 struct ResultEntry
 {
 	union
@@ -62,6 +76,17 @@ struct ResultEntry
 
 typedef std::map<std::string, ResultEntry> SessionResult;
 
+/**
+Counter values by counter name like SessionResult, but the map and its keys
+are allocated from the map's resource. To read results into a FrameArena,
+construct the result with it and pass it to Session::TryGetSampleResult, or
+use the GetSampleResult overload taking a resource.
+*/
+typedef std::map<String, ResultEntry, std::less<String>,
+	Allocator<std::pair<const String, ResultEntry>>> FrameResult;
+
+double ToDouble (const ResultEntry& entry);
+
 struct Counter
 {
 	int				index;
@@ -69,6 +94,28 @@ struct Counter
 	UsageType::Enum usage;
 };
 
+/**
+Status codes returned by the noexcept Try* functions. Non-negative values are
+GPA_Status codes, negative values are errors detected by the wrapper.
+*/
+struct ErrorCode
+{
+	enum Enum
+	{
+		Ok					= 0,
+		UnknownDataType		= -1,	///< GPUPerfAPI returned an unknown counter data type
+		UnknownUsageType	= -2,	///< GPUPerfAPI returned an unknown counter usage type
+		InvalidObject		= -3,	///< Object is default-constructed or moved from, never logged
+		ErrorLogOverflow	= -4	///< Errors were dropped because the error log was full
+	};
+};
+
+struct ErrorRecord
+{
+	int			code;
+	const char*	operation;	///< Static string naming the failed call, e.g. "GPA_EndSample"
+};
+
 class Exception : public std::runtime_error
 {
 public:
@@ -84,20 +131,55 @@ namespace Internal {
 struct ImportTable;
 }
 
+/**
+Observes the Session/Pass/Sample lifecycle and the results read back from
+sessions. Callbacks are invoked synchronously on the thread which issues the
+GPA calls, so implementations should return quickly. They are also invoked
+from noexcept functions and must not throw.
+*/
+class SessionListener
+{
+public:
+	virtual ~SessionListener ();
+
+	virtual void OnBeginSession (const std::uint32_t sessionId) = 0;
+	virtual void OnEndSession (const std::uint32_t sessionId) = 0;
+
+	virtual void OnBeginPass () = 0;
+	virtual void OnEndPass () = 0;
+
+	virtual void OnBeginSample (const std::uint32_t sampleId) = 0;
+	virtual void OnEndSample (const std::uint32_t sampleId) = 0;
+
+	virtual void OnSampleResult (const std::uint32_t sessionId, 
+		const std::uint32_t sampleId, const SessionResult& result) = 0;
+};
+
+/**
+Copies of a counter set share the counter map, which is never modified after
+construction; Keep replaces it with a new, smaller one.
+*/
 class CounterSet
 {
 public:
 	typedef std::map<std::string, Counter> CounterMap;
 
 	CounterSet (Internal::ImportTable* importTable, const CounterMap& counters);
+	CounterSet (Internal::ImportTable* importTable,
+		const std::shared_ptr<const CounterMap>& counters);
 	CounterSet ();
 
+	// Copying only shares the map, and moving would leave it null
+	CounterSet (const CounterSet& other) = default;
+	CounterSet& operator= (const CounterSet& other) = default;
+
 	CounterMap::const_iterator begin () const;
 	CounterMap::const_iterator end () const;
 	CounterMap::const_iterator cbegin () const;
 	CounterMap::const_iterator cend () const;
 
 	const Counter& operator [] (const std::string& name) const;
+	const Counter* Find (const std::string& name) const noexcept;
 
 	void Keep (const std::vector<std::string>& counters);
 
@@ -106,9 +188,13 @@ public:
 	void Enable ();
 	void Disable ();
 
+	int TryGetRequiredPassCount (int& passCount) const noexcept;
+	int TryEnable () noexcept;
+	int TryDisable () noexcept;
+
 private:
-	Internal::ImportTable*			imports_;
-	std::map<std::string, Counter>	counters_;
+	Internal::ImportTable*				imports_;
+	std::shared_ptr<const CounterMap>	counters_;
 };
 
 class Sample
@@ -118,16 +204,26 @@ public:
 	Sample (const Sample& other) = delete;
 	Sample& operator= (const Sample& other) = delete;
 
-	Sample (Sample&& other);
-	Sample& operator= (Sample&& other);
+	Sample (Sample&& other) noexcept;
+	Sample& operator= (Sample&& other) noexcept;
 	
 	Sample (Internal::ImportTable* importTable, std::uint32_t id);
+	Sample ();
 	~Sample ();
 
 	void End ();
+	int TryEnd () noexcept;
+
+	bool IsActive () const noexcept;
 
 private:
+	friend class Pass;
+
+	int Begin () noexcept;
+	int Finish () noexcept;
+
 	Internal::ImportTable*	imports_;
+	std::uint32_t			id_;
 	bool					active_;
 };
 
@@ -138,18 +234,32 @@ public:
 	Pass (const Pass& other) = delete;
 	Pass& operator= (const Pass& other) = delete;
 
-	Pass (Pass&& other);
-	Pass& operator= (Pass&& other);
+	Pass (Pass&& other) noexcept;
+	Pass& operator= (Pass&& other) noexcept;
 	
 	Pass (Internal::ImportTable* importTable);
+	Pass ();
 	~Pass ();
 
 	void End ();
+	int TryEnd () noexcept;
+
+	bool IsActive () const noexcept;
 
 	Sample BeginSample ();
 	Sample BeginSample (const std::uint32_t id);
 
+	/**
+	On success, sample is replaced with the new, active sample.
+	*/
+	int TryBeginSample (const std::uint32_t id, Sample& sample) noexcept;
+
 private:
+	friend class Session;
+
+	int Begin () noexcept;
+	int Finish () noexcept;
+
 	Internal::ImportTable* 	imports_;
 	bool					active_;
 };
@@ -161,10 +271,11 @@ public:
 	Session (const Session& other) = delete;
 	Session& operator= (const Session& other) = delete;
 	
-	Session (Session&& other);
-	Session& operator=(Session&& other);
+	Session (Session&& other) noexcept;
+	Session& operator=(Session&& other) noexcept;
 	
 	Session (Internal::ImportTable* importTable);
+	Session ();
 	~Session ();
 
 	Pass BeginPass ();
@@ -174,7 +285,45 @@ public:
 	SessionResult GetResult (const bool block) const;
 	SessionResult GetResult () const;
 
+	SessionResult GetSampleResult (const std::uint32_t sampleId, const bool block) const;
+	FrameResult GetSampleResult (const std::uint32_t sampleId, const bool block,
+		MemoryResource* resource) const;
+
+	/**
+	On success, pass is replaced with the new, active pass.
+	*/
+	int TryBeginPass (Pass& pass) noexcept;
+	int TryEnd () noexcept;
+
+	bool IsActive () const noexcept;
+
+	int TryIsReady (bool& ready) const noexcept;
+
+	/**
+	If block is false and the session is not ready yet, result is left empty.
+	Allocation failures terminate the process.
+	*/
+	int TryGetResult (const bool block, SessionResult& result) const noexcept;
+	int TryGetSampleResult (const std::uint32_t sampleId, const bool block,
+		SessionResult& result) const noexcept;
+
+	/**
+	The values are allocated from the resource of result. An installed
+	SessionListener receives a SessionResult copy, which is allocated from
+	the heap.
+	*/
+	int TryGetSampleResult (const std::uint32_t sampleId, const bool block,
+		FrameResult& result) const noexcept;
+
 private:
+	friend class Context;
+
+	int Begin () noexcept;
+	int Finish () noexcept;
+	template <typename Result>
+	int ReadResult (const std::uint32_t sampleId, const bool block,
+		Result& result) const noexcept;
+
 	Internal::ImportTable*	imports_;
 	std::uint32_t			id_;
 	bool					active_;
@@ -191,19 +340,58 @@ public:
 	Context ();
 	~Context ();
 
-	Context (Context&& other);
-	Context& operator= (Context&& other);
+	Context (Context&& other) noexcept;
+	Context& operator= (Context&& other) noexcept;
 
 	void Select ();
 	void Close ();
 
+	/**
+	The counters are enumerated once per context, later calls share the
+	result.
+	*/
 	CounterSet	GetAvailableCounters () const;
 
 	Session BeginSession ();
 
+	int TrySelect () noexcept;
+	int TryClose () noexcept;
+
+	/**
+	Allocation failures terminate the process.
+	*/
+	int TryGetAvailableCounters (CounterSet& counters) const noexcept;
+
+	/**
+	On success, session is replaced with the new, active session.
+	*/
+	int TryBeginSession (Session& session) noexcept;
+
+	/**
+	Move up to capacity of the errors logged since the last call into errors
+	and return how many were written.
+
+	All failed Try* calls and all errors in destructors, which cannot be
+	reported otherwise, are logged, except for ErrorCode::InvalidObject: an
+	object without a library has no log to write to. The log holds a limited number of errors;
+	if it overflowed, the last record drained has the code
+	ErrorCode::ErrorLogOverflow. The log is shared by all contexts of a
+	library.
+	*/
+	std::size_t DrainErrors (ErrorRecord* errors, const std::size_t capacity) noexcept;
+
 private:
+	friend class PerformanceLibrary;
+
+	int Open (void* ctx) noexcept;
+	int Shutdown () noexcept;
+	int ReadCounters (CounterSet::CounterMap& counters) const noexcept;
+	int GetCatalogue (std::shared_ptr<const CounterSet::CounterMap>& counters) const noexcept;
+
 	Internal::ImportTable*	imports_;
 	void*					context_;
+
+	mutable std::shared_ptr<const CounterSet::CounterMap>	catalogue_;
 };
 
 class PerformanceLibrary
@@ -214,10 +402,31 @@ public:
 	PerformanceLibrary& operator= (const PerformanceLibrary& other) = delete;
 
 	PerformanceLibrary (const ProfileApi::Enum targetApi);
+
+	/**
+	With LibraryMode::Record, every GPA call including its arguments, status
+	and returned values is logged to logFile. With LibraryMode::Replay, no
+	GPUPerfAPI library is loaded, instead all calls are served from a log
+	previously recorded for the same targetApi.
+	*/
+	PerformanceLibrary (const ProfileApi::Enum targetApi,
+		const LibraryMode::Enum mode, const std::string& logFile);
 	~PerformanceLibrary ();
 
 	Context	OpenContext (void* ctx);
 
+	/**
+	On success, context is replaced with the newly opened context.
+	*/
+	int TryOpenContext (void* ctx, Context& context) noexcept;
+
+	/**
+	Install a listener which is notified about all sessions, passes and
+	samples started through this library. Pass nullptr to remove it. The
+	listener must outlive all objects created through this library.
+	*/
+	void SetListener (SessionListener* listener);
+
 private:
 	struct Impl;
 	Impl*	impl_;
@@ -0,0 +1,371 @@
+// Aggregates counter values over many captures written by CaptureWriter,
+// grouped by build, scope and counter, and reports count, mean and
+// percentiles per group.
+//
+// Usage: AmdPerfQuery [options] <capture>...
+//
+//	--files <list>				Read capture names from list, one per line, - for
+//								stdin
+//	--scope <name>				Only this scope, can be repeated
+//	--counter <name>			Only this counter, can be repeated
+//	--frames <first>:<last>		Only frames within [first, last], either bound
+//								may be omitted
+//	--percentile <p>			Report this percentile, can be repeated, default
+//								50, 90 and 99
+//	--baseline <build>			Report the change of the mean relative to build
+//	--min-delta <pct>			Only report groups whose mean changed by at least
+//								pct percent relative to the baseline; negative
+//								values select decreases
+//	--threads <n>				Worker threads, default all cores
+//
+// For instance, to find the builds which regressed FetchSize in the shadow
+// pass by more than 2%:
+//
+//	AmdPerfQuery --scope shadow --counter FetchSize --baseline 1041 --min-delta 2 *.aplc
+//
+// Captures are memory mapped and scanned in chunks on all threads; filters are
+// resolved against the counter catalogue and scope names of each capture
+// first, so rejected records are skipped without decoding them. Percentiles
+// are estimated from histograms with 1% wide buckets, which keeps memory use
+// independent of the size of the captures. Histograms and scanning are
+// implemented in CaptureQuery.cpp.
+//
+// Exits with 0 on success and 2 on errors. Captures which cannot be read are
+// skipped with a warning.
+
+#include "CaptureQuery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <tuple>
+
+namespace {
+struct Options
+{
+	Options ()
+	: hasBaseline (false)
+	, hasMinDelta (false)
+	, minDelta (0)
+	, threadCount (std::max (1u, std::thread::hardware_concurrency ()))
+	{
+	}
+
+	std::vector<std::string>	files;
+	Amd::QueryFilter			filter;
+	std::vector<double>			percentiles;
+	bool						hasBaseline;
+	std::string					baseline;
+	bool						hasMinDelta;
+	double						minDelta;
+	unsigned int				threadCount;
+};
+
+struct Capture
+{
+	std::unique_ptr<Amd::CaptureReader>	reader;
+	std::vector<bool>					counters;	///< Selected, by catalogue index
+};
+
+struct Chunk
+{
+	const Capture*	capture;
+	std::size_t		begin;
+	std::size_t		end;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/**
+Rethrows the first exception thrown by f once all threads are done; the
+remaining items are skipped.
+*/
+template <typename F>
+void ParallelFor (const std::size_t count, const unsigned int threadCount, F f)
+{
+	std::atomic<std::size_t> next (0);
+	std::vector<std::thread> threads;
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	for (unsigned int t = 0; t < threadCount; ++t) {
+		threads.emplace_back ([&, t] () {
+			try {
+				for (std::size_t i = next++; i < count; i = next++) {
+					f (t, i);
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> lock (errorMutex);
+
+				if (!error) {
+					error = std::current_exception ();
+				}
+
+				next = count;
+			}
+		});
+	}
+
+	for (auto& thread : threads) {
+		thread.join ();
+	}
+
+	if (error) {
+		std::rethrow_exception (error);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<Capture> Open (const Options& options)
+{
+	std::vector<Capture> captures (options.files.size ());
+	std::mutex warningMutex;
+
+	ParallelFor (captures.size (), options.threadCount,
+		[&] (const unsigned int, const std::size_t i) {
+		try {
+			captures [i].reader.reset (new Amd::CaptureReader (options.files [i]));
+		} catch (const std::exception& e) {
+			std::lock_guard<std::mutex> lock (warningMutex);
+			std::cerr << "Skipping " << options.files [i] << ": " << e.what () << std::endl;
+			return;
+		}
+
+		// Scopes of unclosed captures are only known as "#<scope>"
+		if (!options.filter.scopes.empty () && !captures [i].reader->IsClosed ()) {
+			std::lock_guard<std::mutex> lock (warningMutex);
+			std::cerr << "Warning: " << options.files [i]
+				<< " was not closed and has no scope names, --scope only matches #<scope>"
+				<< std::endl;
+		}
+
+		captures [i].counters = Amd::SelectCounters (*captures [i].reader, options.filter);
+	});
+
+	captures.erase (std::remove_if (captures.begin (), captures.end (),
+		[] (const Capture& capture) { return !capture.reader; }), captures.end ());
+
+	return captures;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Amd::QueryAggregates Query (const std::vector<Capture>& captures, const Options& options)
+{
+	const std::size_t chunkSize = 1 << 20;
+	std::vector<Chunk> chunks;
+
+	for (const auto& capture : captures) {
+		const auto recordCount = capture.reader->GetRecordCount ();
+
+		for (std::size_t begin = 0; begin < recordCount; begin += chunkSize) {
+			Chunk chunk = { &capture, begin, std::min (recordCount, begin + chunkSize) };
+			chunks.push_back (chunk);
+		}
+	}
+
+	// One set of groups per thread, merged at the end
+	std::vector<Amd::QueryAggregates> partial (options.threadCount);
+
+	ParallelFor (chunks.size (), options.threadCount,
+		[&] (const unsigned int thread, const std::size_t i) {
+		const auto& chunk = chunks [i];
+		Amd::ScanCapture (*chunk.capture->reader, chunk.capture->counters,
+			chunk.begin, chunk.end, options.filter, partial [thread]);
+	});
+
+	Amd::QueryAggregates result;
+
+	for (const auto& aggregates : partial) {
+		for (const auto& kv : aggregates) {
+			result [kv.first].Merge (kv.second);
+		}
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PrintUsage ()
+{
+	std::cerr << "Usage: AmdPerfQuery [--files <list>] [--scope <name>] [--counter <name>] "
+		"[--frames <first>:<last>] [--percentile <p>] [--baseline <build>] "
+		"[--min-delta <pct>] [--threads <n>] <capture>..." << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReadFileList (const std::string& list, std::vector<std::string>& files)
+{
+	std::ifstream file;
+
+	if (list != "-") {
+		file.open (list);
+
+		if (!file) {
+			return false;
+		}
+	}
+
+	std::istream& input = list == "-" ? std::cin : file;
+	std::string line;
+
+	while (std::getline (input, line)) {
+		if (!line.empty () && line.back () == '\r') {
+			line.pop_back ();
+		}
+
+		if (!line.empty ()) {
+			files.push_back (line);
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ParseOptions (int argc, char* argv [], Options& options)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv [i];
+
+		if (arg.size () > 2 && arg [0] == '-' && arg [1] == '-') {
+			if (i + 1 >= argc) {
+				return false;
+			}
+
+			const std::string value = argv [++i];
+
+			if (arg == "--files") {
+				if (!ReadFileList (value, options.files)) {
+					std::cerr << "Could not read file list: " << value << std::endl;
+					return false;
+				}
+			} else if (arg == "--scope") {
+				options.filter.scopes.push_back (value);
+			} else if (arg == "--counter") {
+				options.filter.counters.push_back (value);
+			} else if (arg == "--frames") {
+				const auto separator = value.find (':');
+				const auto first = value.substr (0, separator);
+				const auto last = separator == std::string::npos
+					? first : value.substr (separator + 1);
+
+				if (!first.empty ()) {
+					options.filter.firstFrame = std::stoull (first);
+				}
+
+				if (!last.empty ()) {
+					options.filter.lastFrame = std::stoull (last);
+				}
+			} else if (arg == "--percentile") {
+				const double p = std::stod (value);
+				if (p < 0 || p > 100) {
+					return false;
+				}
+				options.percentiles.push_back (p);
+			} else if (arg == "--baseline") {
+				options.hasBaseline = true;
+				options.baseline = value;
+			} else if (arg == "--min-delta") {
+				options.hasMinDelta = true;
+				options.minDelta = std::stod (value);
+			} else if (arg == "--threads") {
+				options.threadCount = static_cast<unsigned int> (std::max (1, std::stoi (value)));
+			} else {
+				return false;
+			}
+		} else {
+			options.files.push_back (arg);
+		}
+	}
+
+	if (options.percentiles.empty ()) {
+		options.percentiles.push_back (50);
+		options.percentiles.push_back (90);
+		options.percentiles.push_back (99);
+	}
+
+	return !options.files.empty () && (options.hasBaseline || !options.hasMinDelta);
+}
+}
+
+int main (int argc, char* argv [])
+{
+	Options options;
+
+	try {
+		if (!ParseOptions (argc, argv, options)) {
+			PrintUsage ();
+			return 2;
+		}
+
+		const auto captures = Open (options);
+		const auto aggregates = Query (captures, options);
+
+		::printf ("%-16s %-24s %-32s %10s %14s", "build", "scope", "counter", "n", "mean");
+		for (const auto p : options.percentiles) {
+			char label [32];
+			::snprintf (label, sizeof (label), "p%g", p);
+			::printf (" %14s", label);
+		}
+		if (options.hasBaseline) {
+			::printf (" %9s", "delta%");
+		}
+		::printf ("\n");
+
+		for (const auto& kv : aggregates) {
+			const auto& aggregate = kv.second;
+
+			if (aggregate.count == 0) {
+				continue;
+			}
+
+			const double mean = aggregate.sum / static_cast<double> (aggregate.count);
+			bool hasDelta = false;
+			double delta = 0;
+
+			if (options.hasBaseline) {
+				auto it = aggregates.find (Amd::QueryKey (options.baseline,
+					std::get<1> (kv.first), std::get<2> (kv.first)));
+
+				if (it != aggregates.end () && it->second.count > 0) {
+					const double baselineMean = it->second.sum / static_cast<double> (it->second.count);
+					hasDelta = baselineMean != 0;
+					delta = hasDelta ? (mean - baselineMean) / std::abs (baselineMean) * 100 : 0;
+				}
+
+				if (options.hasMinDelta && (!hasDelta || (options.minDelta >= 0
+					? delta < options.minDelta : delta > options.minDelta))) {
+					continue;
+				}
+			}
+
+			::printf ("%-16s %-24s %-32s %10llu %14.6g", std::get<0> (kv.first).c_str (),
+				std::get<1> (kv.first).c_str (), std::get<2> (kv.first).c_str (),
+				static_cast<unsigned long long> (aggregate.count), mean);
+
+			for (const auto p : options.percentiles) {
+				::printf (" %14.6g", aggregate.histogram.GetPercentile (p, aggregate.count));
+			}
+
+			if (hasDelta) {
+				::printf (" %+9.2f", delta);
+			} else if (options.hasBaseline) {
+				::printf (" %9s", "n/a");
+			}
+
+			::printf ("\n");
+		}
+
+		return 0;
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what () << std::endl;
+		return 2;
+	}
+}
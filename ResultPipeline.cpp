@@ -0,0 +1,402 @@
+#include "ResultPipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Amd {
+namespace {
+/**
+One submission. Results are either processed as a whole, or split into
+blocks which are merged again before committing.
+*/
+struct Item
+{
+	std::uint32_t						sessionId;
+	ResultPipeline::SampleResults		samples;
+	std::vector<std::vector<SessionResult>>	blocks;		///< Per sample, if split
+	std::atomic<std::size_t>			remaining;		///< Tasks not finished yet
+	bool								done;
+	bool								failed;
+};
+
+struct Task
+{
+	Item*		item;
+	bool		split;		///< Split item into blocks and queue them
+	std::size_t	sample;
+	std::size_t	block;
+};
+
+struct TaskQueue
+{
+	std::mutex			mutex;
+	std::deque<Task>	tasks;
+};
+}
+
+struct ResultPipeline::Impl
+{
+	Impl (const Process& process, const Commit& commit,
+		const ResultPipelineConfig& config)
+	: process_ (process)
+	, commit_ (commit)
+	, counterBlockSize_ (config.counterBlockSize)
+	, maxPending_ (config.maxPending)
+	, queued_ (0)
+	, nextQueue_ (0)
+	, stop_ (false)
+	, committing_ (false)
+	{
+		std::size_t threads = config.threads;
+
+		if (threads == 0) {
+			threads = std::max (1u, std::thread::hardware_concurrency ()) - 1;
+		}
+
+		threads = std::max<std::size_t> (1, threads);
+
+		for (std::size_t i = 0; i < threads; ++i) {
+			queues_.emplace_back (new TaskQueue);
+		}
+
+		for (std::size_t i = 0; i < threads; ++i) {
+			threads_.emplace_back (&Impl::Run, this, i);
+		}
+	}
+
+	~Impl ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			stop_ = true;
+		}
+
+		wake_.notify_all ();
+
+		for (auto& thread : threads_) {
+			thread.join ();
+		}
+	}
+
+	/**
+	Queue the item as a single task, so even splitting it into blocks happens
+	on a worker.
+	*/
+	void Submit (const std::uint32_t sessionId, SampleResults&& samples)
+	{
+		std::unique_ptr<Item> item (new Item);
+		item->sessionId = sessionId;
+		item->samples = std::move (samples);
+		item->remaining = 1;
+		item->done = false;
+		item->failed = false;
+
+		const Task task = { item.get (), counterBlockSize_ > 0, 0, 0 };
+
+		{
+			std::unique_lock<std::mutex> lock (mutex_);
+
+			if (maxPending_ > 0) {
+				done_.wait (lock, [this] () { return pending_.size () < maxPending_; });
+			}
+
+			pending_.push_back (std::move (item));
+		}
+
+		Enqueue (std::vector<Task> (1, task));
+	}
+
+	/**
+	Distribute tasks round-robin over the queues.
+	*/
+	void Enqueue (const std::vector<Task>& tasks)
+	{
+		std::size_t first = 0;
+
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			first = nextQueue_;
+			nextQueue_ = (nextQueue_ + tasks.size ()) % queues_.size ();
+			queued_ += tasks.size ();
+		}
+
+		for (std::size_t i = 0; i < tasks.size (); ++i) {
+			TaskQueue& queue = *queues_ [(first + i) % queues_.size ()];
+			std::lock_guard<std::mutex> lock (queue.mutex);
+			queue.tasks.push_back (tasks [i]);
+		}
+
+		wake_.notify_all ();
+	}
+
+	/**
+	Split every sample into blocks of counterBlockSize counters and queue a
+	task per block.
+	*/
+	void Split (Item& item)
+	{
+		std::vector<Task> tasks;
+		item.blocks.resize (item.samples.size ());
+
+		for (std::size_t i = 0; i < item.samples.size (); ++i) {
+			const auto& result = item.samples [i].second;
+			auto& blocks = item.blocks [i];
+			std::size_t count = 0;
+
+			for (const auto& kv : result) {
+				if (count++ % counterBlockSize_ == 0) {
+					Task task = { &item, false, i, blocks.size () };
+					tasks.push_back (task);
+					blocks.emplace_back ();
+				}
+
+				blocks.back ().insert (kv);
+			}
+		}
+
+		if (tasks.empty ()) {
+			return;
+		}
+
+		// Before queueing, so the item cannot be finished in between
+		item.remaining += tasks.size ();
+		Enqueue (tasks);
+	}
+
+	/**
+	Take the oldest task of the own queue, or steal the newest one of another
+	queue.
+	*/
+	bool Take (const std::size_t index, Task& task)
+	{
+		for (std::size_t i = 0; i < queues_.size (); ++i) {
+			TaskQueue& queue = *queues_ [(index + i) % queues_.size ()];
+			std::lock_guard<std::mutex> lock (queue.mutex);
+
+			if (queue.tasks.empty ()) {
+				continue;
+			}
+
+			if (i == 0) {
+				task = queue.tasks.front ();
+				queue.tasks.pop_front ();
+			} else {
+				task = queue.tasks.back ();
+				queue.tasks.pop_back ();
+			}
+
+			--queued_;
+			return true;
+		}
+
+		return false;
+	}
+
+	void Run (const std::size_t index)
+	{
+		for (;;) {
+			Task task;
+
+			if (!Take (index, task)) {
+				std::unique_lock<std::mutex> lock (mutex_);
+				wake_.wait (lock, [this] () { return queued_ > 0 || stop_; });
+
+				if (stop_ && queued_ == 0) {
+					return;
+				}
+
+				continue;
+			}
+
+			Execute (task);
+		}
+	}
+
+	void Execute (const Task& task)
+	{
+		Item& item = *task.item;
+
+		try {
+			if (task.split) {
+				Split (item);
+			} else if (item.blocks.empty ()) {
+				for (auto& sample : item.samples) {
+					process_ (item.sessionId, sample.first, sample.second);
+				}
+			} else {
+				process_ (item.sessionId, item.samples [task.sample].first,
+					item.blocks [task.sample][task.block]);
+			}
+		} catch (...) {
+			SetError (std::current_exception ());
+
+			std::lock_guard<std::mutex> lock (mutex_);
+			item.failed = true;
+		}
+
+		if (--item.remaining == 0) {
+			{
+				std::lock_guard<std::mutex> lock (mutex_);
+				item.done = true;
+			}
+
+			CommitReady ();
+		}
+	}
+
+	/**
+	Commit finished items from the front. Only one thread commits at a time,
+	the others return immediately and leave their items to it.
+	*/
+	void CommitReady ()
+	{
+		std::unique_lock<std::mutex> lock (mutex_);
+
+		if (committing_) {
+			return;
+		}
+
+		committing_ = true;
+
+		// Checked under the same lock as committing_ is reset, so items
+		// finished meanwhile are never left behind
+		while (!pending_.empty () && pending_.front ()->done) {
+			Item* item = pending_.front ().get ();
+			lock.unlock ();
+
+			if (!item->failed) {
+				try {
+					for (std::size_t i = 0; i < item->samples.size (); ++i) {
+						auto& sample = item->samples [i];
+
+						if (!item->blocks.empty ()) {
+							sample.second.clear ();
+
+							for (const auto& block : item->blocks [i]) {
+								sample.second.insert (block.begin (), block.end ());
+							}
+						}
+
+						commit_ (item->sessionId, sample.first, sample.second);
+					}
+				} catch (...) {
+					SetError (std::current_exception ());
+				}
+			}
+
+			lock.lock ();
+			pending_.pop_front ();
+			done_.notify_all ();
+		}
+
+		committing_ = false;
+	}
+
+	void SetError (const std::exception_ptr& error)
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+
+		if (!error_) {
+			error_ = error;
+		}
+	}
+
+	void Flush ()
+	{
+		std::unique_lock<std::mutex> lock (mutex_);
+		done_.wait (lock, [this] () { return pending_.empty (); });
+
+		if (error_) {
+			auto error = error_;
+			error_ = nullptr;
+			std::rethrow_exception (error);
+		}
+	}
+
+	Process									process_;
+	Commit									commit_;
+	std::size_t								counterBlockSize_;
+	std::size_t								maxPending_;
+
+	std::vector<std::unique_ptr<TaskQueue>>	queues_;		///< One per worker
+	std::atomic<std::size_t>				queued_;		///< Tasks in all queues
+
+	std::mutex								mutex_;
+	std::condition_variable					wake_;
+	std::condition_variable					done_;
+	std::deque<std::unique_ptr<Item>>		pending_;		///< Not committed yet, in order
+	std::size_t								nextQueue_;
+	std::exception_ptr						error_;
+	bool									stop_;
+	bool									committing_;	///< A thread is in CommitReady
+	std::vector<std::thread>				threads_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+ResultPipeline::ResultPipeline (const Process& process, const Commit& commit,
+	const ResultPipelineConfig& config)
+: impl_ (new Impl (process, commit, config))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ResultPipeline::~ResultPipeline ()
+{
+	// Commit what is pending, but don't throw from the destructor
+	try {
+		impl_->Flush ();
+	} catch (...) {
+	}
+
+	delete impl_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ResultPipeline::Submit (const std::uint32_t sessionId,
+	const std::uint32_t sampleId, const SessionResult& result)
+{
+	SampleResults samples;
+	samples.emplace_back (sampleId, result);
+
+	impl_->Submit (sessionId, std::move (samples));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ResultPipeline::Submit (const std::uint32_t sessionId,
+	const std::uint32_t sampleId, SessionResult&& result)
+{
+	SampleResults samples;
+	samples.emplace_back (sampleId, std::move (result));
+
+	impl_->Submit (sessionId, std::move (samples));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ResultPipeline::Submit (const std::uint32_t sessionId, SampleResults&& samples)
+{
+	impl_->Submit (sessionId, std::move (samples));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ResultPipeline::Flush ()
+{
+	impl_->Flush ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ResultPipeline::Commit ResultPipeline::ToListener (SessionListener& listener)
+{
+	SessionListener* target = &listener;
+
+	return [target] (const std::uint32_t sessionId, const std::uint32_t sampleId,
+		const SessionResult& result) {
+		target->OnSampleResult (sessionId, sampleId, result);
+	};
+}
+}
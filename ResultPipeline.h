@@ -0,0 +1,94 @@
+#ifndef NIV_AMD_PERF_LIB_RESULTPIPELINE_H_5B9E2D48_A17C_4F3E_8C61_D02F7A4B93E6
+#define NIV_AMD_PERF_LIB_RESULTPIPELINE_H_5B9E2D48_A17C_4F3E_8C61_D02F7A4B93E6
+
+#include "PerfLib.h"
+
+#include <functional>
+
+namespace Amd {
+/**
+threads defaults to one less than the number of cores. If counterBlockSize is
+non-zero, every result is split into blocks of that many counters, which are
+processed independently. Submit blocks while maxPending submissions are not
+committed yet; 0 means unbounded.
+*/
+struct ResultPipelineConfig
+{
+	ResultPipelineConfig ()
+	: threads (0)
+	, counterBlockSize (0)
+	, maxPending (0)
+	{
+	}
+
+	std::size_t	threads;
+	std::size_t	counterBlockSize;
+	std::size_t	maxPending;
+};
+
+/**
+Moves the processing of results off the thread which reads them back.
+
+Submitted results are processed on a pool of worker threads, either a whole
+session at a time or, with counterBlockSize set, in blocks of counters; idle
+workers steal work from the others. Afterwards, they are committed in the
+order they were submitted, one at a time, so exporters need not be thread
+safe. Submit only queues the result; splitting, processing and committing all
+happen on the workers. None of them calls GPUPerfAPI; reading back results
+remains with the thread owning the context.
+*/
+class ResultPipeline
+{
+public:
+	// Noncopyable
+	ResultPipeline (const ResultPipeline& other) = delete;
+	ResultPipeline& operator= (const ResultPipeline& other) = delete;
+
+	/**
+	Normalization, derived metrics and so on. Called concurrently, with a block
+	of counters only if counterBlockSize is set.
+	*/
+	typedef std::function<void (const std::uint32_t sessionId,
+		const std::uint32_t sampleId, SessionResult& result)> Process;
+
+	/**
+	Aggregation and export. Called with the complete result, in order.
+	*/
+	typedef std::function<void (const std::uint32_t sessionId,
+		const std::uint32_t sampleId, const SessionResult& result)> Commit;
+
+	typedef std::vector<std::pair<std::uint32_t, SessionResult>> SampleResults;
+
+	ResultPipeline (const Process& process, const Commit& commit,
+		const ResultPipelineConfig& config = ResultPipelineConfig ());
+	~ResultPipeline ();
+
+	void Submit (const std::uint32_t sessionId, const std::uint32_t sampleId,
+		const SessionResult& result);
+	void Submit (const std::uint32_t sessionId, const std::uint32_t sampleId,
+		SessionResult&& result);
+
+	/**
+	Submit all samples of a session at once, as one unit of work.
+	*/
+	void Submit (const std::uint32_t sessionId, SampleResults&& samples);
+
+	/**
+	Block until everything submitted so far has been committed. Rethrows the
+	first exception thrown by process or commit; results for which process
+	failed are not committed.
+	*/
+	void Flush ();
+
+	/**
+	Commit using listener.OnSampleResult.
+	*/
+	static Commit ToListener (SessionListener& listener);
+
+private:
+	struct Impl;
+	Impl*	impl_;
+};
+}
+
+#endif
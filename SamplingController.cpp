@@ -0,0 +1,312 @@
+#include "SamplingController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace Amd {
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+/**
+Measurements needed at a counter set before the controller steps to another.
+*/
+const std::size_t SamplesPerStep = 4;
+
+struct Step
+{
+	CounterSet	counters;
+	int			passCount;
+	double		cost;		///< Average extra time of a profiled frame in seconds
+	std::size_t	samples;	///< Number of measurements in cost
+};
+}
+
+struct SamplingController::Impl
+{
+	Impl (const CounterSet& available, const std::vector<std::string>& counters,
+		const SamplingConfig& config)
+	: config_ (config)
+	, step_ (0)
+	, pendingStep_ (0)
+	, interval_ (std::max<std::size_t> (2, config.minInterval))
+	, baseline_ (0)
+	, baselineSamples_ (0)
+	, pendingOverhead_ (0)
+	, carriedOverhead_ (0)
+	, frames_ (0)
+	, framesSinceProfile_ (0)
+	, lastProfiled_ (false)
+	{
+		config_.minInterval = interval_;
+		config_.maxInterval = std::max (config_.maxInterval, config_.minInterval);
+
+		std::vector<std::string> names;
+		for (const auto& name : counters) {
+			if (available.Find (name) != nullptr
+				&& std::find (names.begin (), names.end (), name) == names.end ()) {
+				names.push_back (name);
+			}
+		}
+
+		if (names.empty ()) {
+			throw std::runtime_error ("None of the sampled counters is available.");
+		}
+
+		// Pass count of every prefix, by enabling one counter after the other
+		std::vector<int> passCounts;
+		for (const auto& name : names) {
+			CounterSet counter = available;
+			counter.Keep (std::vector<std::string> (1, name));
+			counter.Enable ();
+			passCounts.push_back (counter.GetRequiredPassCount ());
+		}
+
+		CounterSet all = available;
+		all.Keep (names);
+		all.Disable ();
+
+		// Largest prefix for each pass count
+		std::vector<std::size_t> sizes;
+		for (std::size_t i = 0; i < names.size (); ++i) {
+			if (i + 1 == names.size () || passCounts [i + 1] != passCounts [i]) {
+				sizes.push_back (i + 1);
+			}
+		}
+
+		// Halvings of the smallest one
+		for (std::size_t size = sizes.front () / 2; size > 0; size /= 2) {
+			sizes.insert (sizes.begin (), size);
+		}
+
+		for (const auto size : sizes) {
+			Step step;
+			step.counters = available;
+			step.counters.Keep (std::vector<std::string> (names.begin (), names.begin () + size));
+			step.passCount = std::max (1, passCounts [size - 1]);
+			step.cost = 0;
+			step.samples = 0;
+			steps_.push_back (step);
+		}
+
+		steps_ [step_].counters.Enable ();
+	}
+
+	~Impl ()
+	{
+		steps_ [step_].counters.TryDisable ();
+	}
+
+	SamplingPlan BeginFrame (const Clock::time_point now)
+	{
+		if (frames_ > 0) {
+			const double duration = std::chrono::duration<double> (now - last_).count ();
+			const double overhead = pendingOverhead_;
+			pendingOverhead_ = 0;
+
+			if (lastProfiled_) {
+				Measure (std::max (0.0, duration - baseline_) + carriedOverhead_ + overhead);
+				carriedOverhead_ = 0;
+			} else {
+				// Attributed to the next profiled frame, as it is typically
+				// the readback of the previous one
+				carriedOverhead_ += overhead;
+				UpdateBaseline (std::max (0.0, duration - overhead));
+			}
+		}
+
+		last_ = now;
+		++frames_;
+
+		SamplingPlan plan;
+		// A profiled session may still be waiting for its readback, so the
+		// counters are only changed in ApplyPendingStep
+		plan.changePending = pendingStep_ != step_;
+		plan.profile = frames_ > config_.warmupFrames && baselineSamples_ > 0
+			&& framesSinceProfile_ + 1 >= interval_ && !plan.changePending;
+		plan.passCount = steps_ [step_].passCount;
+		plan.counters = &steps_ [step_].counters;
+		plan.interval = interval_;
+
+		if (plan.profile) {
+			framesSinceProfile_ = 0;
+		} else {
+			++framesSinceProfile_;
+		}
+
+		lastProfiled_ = plan.profile;
+
+		return plan;
+	}
+
+	void UpdateBaseline (const double duration)
+	{
+		if (baselineSamples_++ == 0) {
+			baseline_ = duration;
+		} else {
+			baseline_ += config_.smoothing * (duration - baseline_);
+		}
+	}
+
+	void Measure (const double cost)
+	{
+		Step& step = steps_ [step_];
+
+		if (step.samples++ == 0) {
+			step.cost = cost;
+		} else {
+			step.cost += config_.smoothing * (cost - step.cost);
+		}
+
+		if (step.samples >= SamplesPerStep) {
+			if (GetRequiredInterval (step.cost) > config_.maxInterval && step_ > 0) {
+				pendingStep_ = step_ - 1;
+			} else if (step_ + 1 < steps_.size ()
+				&& GetRequiredInterval (Predict (step_ + 1)) <= config_.maxInterval / 2) {
+				pendingStep_ = step_ + 1;
+			}
+		}
+
+		UpdateInterval ();
+	}
+
+	/**
+	A single expensive frame must not stop profiling for long, so the
+	interval never exceeds maxInterval, even if that exceeds the budget.
+	*/
+	void UpdateInterval ()
+	{
+		interval_ = std::min (GetRequiredInterval (Predict (step_)), config_.maxInterval);
+	}
+
+	/**
+	Estimated cost of a step, scaled by the pass count from the current one
+	if it has not been measured yet.
+	*/
+	double Predict (const std::size_t index) const
+	{
+		if (steps_ [index].samples > 0 || index == step_) {
+			return steps_ [index].cost;
+		}
+
+		return steps_ [step_].cost * steps_ [index].passCount / steps_ [step_].passCount;
+	}
+
+	std::size_t GetRequiredInterval (const double cost) const
+	{
+		const double allowed = config_.budget * baseline_;
+
+		if (allowed <= 0) {
+			return config_.maxInterval;
+		}
+
+		// Every interval-th frame costs cost, so the average is cost/interval
+		const double interval = std::ceil (cost / allowed);
+
+		if (interval >= static_cast<double> (std::numeric_limits<std::size_t>::max ())) {
+			return std::numeric_limits<std::size_t>::max ();
+		}
+
+		return std::max (config_.minInterval, static_cast<std::size_t> (interval));
+	}
+
+	bool ApplyPendingStep ()
+	{
+		if (pendingStep_ == step_) {
+			return false;
+		}
+
+		const std::size_t index = pendingStep_;
+		steps_ [step_].counters.Disable ();
+
+		// Keep the measured cost, but let a step which has been left be
+		// measured again before stepping away from it
+		steps_ [index].cost = Predict (index);
+		steps_ [index].samples = std::min (steps_ [index].samples, std::size_t (1));
+		steps_ [index].counters.Enable ();
+		step_ = index;
+
+		UpdateInterval ();
+
+		return true;
+	}
+
+	SamplingConfig			config_;
+	std::vector<Step>		steps_;			///< Ordered by number of counters
+	std::size_t				step_;
+	std::size_t				pendingStep_;	///< Step to change to, step_ if none
+	std::size_t				interval_;
+
+	double					baseline_;		///< Average unprofiled frame time in seconds
+	std::size_t				baselineSamples_;
+	double					pendingOverhead_;
+	double					carriedOverhead_;
+
+	Clock::time_point		last_;
+	std::size_t				frames_;
+	std::size_t				framesSinceProfile_;
+	bool					lastProfiled_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+SamplingController::SamplingController (const CounterSet& available,
+	const std::vector<std::string>& counters, const SamplingConfig& config)
+: impl_ (new Impl (available, counters, config))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SamplingController::~SamplingController ()
+{
+	delete impl_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SamplingPlan SamplingController::BeginFrame ()
+{
+	return impl_->BeginFrame (Clock::now ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SamplingPlan SamplingController::BeginFrame (const std::chrono::steady_clock::time_point now)
+{
+	return impl_->BeginFrame (now);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SamplingController::ApplyPendingStep ()
+{
+	return impl_->ApplyPendingStep ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SamplingController::AddOverhead (const std::chrono::steady_clock::duration duration)
+{
+	impl_->pendingOverhead_ += std::chrono::duration<double> (duration).count ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double SamplingController::GetOverhead () const
+{
+	if (impl_->baseline_ <= 0) {
+		return 0;
+	}
+
+	return impl_->Predict (impl_->step_)
+		/ (static_cast<double> (impl_->interval_) * impl_->baseline_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SamplingController::ScopedOverhead::ScopedOverhead (SamplingController& controller)
+: controller_ (controller)
+, start_ (Clock::now ())
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SamplingController::ScopedOverhead::~ScopedOverhead ()
+{
+	controller_.AddOverhead (Clock::now () - start_);
+}
+}
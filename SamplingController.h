@@ -0,0 +1,126 @@
+#ifndef NIV_AMD_PERF_LIB_SAMPLINGCONTROLLER_H_7C2E9A54_1F3B_4E86_9D0A_B6F4C3E2851D
+#define NIV_AMD_PERF_LIB_SAMPLINGCONTROLLER_H_7C2E9A54_1F3B_4E86_9D0A_B6F4C3E2851D
+
+#include "PerfLib.h"
+
+#include <chrono>
+
+namespace Amd {
+/**
+budget is the fraction of frame time profiling may take on average, for
+instance 0.01 for 1%. maxInterval is the longest distance between profiled
+frames; if even the smallest counter set does not fit into the budget at that
+distance, the budget is exceeded, see SamplingController::GetOverhead.
+minInterval must be at least 2, as the baseline frame time is measured on the
+unprofiled frames in between.
+*/
+struct SamplingConfig
+{
+	SamplingConfig ()
+	: budget (0.01)
+	, minInterval (2)
+	, maxInterval (1000)
+	, warmupFrames (16)
+	, smoothing (0.1)
+	{
+	}
+
+	double		budget;
+	std::size_t	minInterval;
+	std::size_t	maxInterval;
+	std::size_t	warmupFrames;	///< Unprofiled frames to measure the baseline frame time
+	double		smoothing;		///< Weight of a new measurement in the running averages
+};
+
+struct SamplingPlan
+{
+	bool				profile;		///< Profile this frame
+	int					passCount;		///< Passes needed for counters
+	const CounterSet*	counters;		///< Enabled counters
+	std::size_t			interval;		///< Current distance between profiled frames
+	bool				changePending;	///< Call ApplyPendingStep once all results have been read
+};
+
+/**
+Decides which frames to profile, and with how many counters, to keep the
+profiling overhead within a budget.
+
+The overhead of a profiled frame is estimated as the difference between its
+duration and the average duration of unprofiled frames, so it covers the
+wrapper, GPUPerfAPI and the additional passes. Work done for profiling in
+other frames, such as reading back results later, should be reported using
+AddOverhead or ScopedOverhead.
+
+From the overhead, the controller picks the shortest interval between
+profiled frames which stays within the budget. If that interval is longer
+than maxInterval, it steps down to fewer counters; if the next larger set
+would fit into half of maxInterval, it steps up. Counters are taken from the
+front of the list passed in; the steps are the largest sets which fit into
+one, two, ... passes, and halvings of the one-pass set. The estimates are
+updated continuously, so when profiling gets more expensive relative to the
+frame time, for instance under load, the controller backs off, and ramps up
+again once there is headroom. It starts with the smallest set.
+
+The controller enables and disables the counters itself, no other counters
+may be enabled. Results are read for the counters enabled when reading them,
+so after deciding to change the counters, the controller stops profiling
+until ApplyPendingStep is called, which the caller must do once the results
+of all profiled frames have been read back and no session is active. All
+calls must be made from the same thread.
+*/
+class SamplingController
+{
+public:
+	// Noncopyable
+	SamplingController (const SamplingController& other) = delete;
+	SamplingController& operator= (const SamplingController& other) = delete;
+
+	/**
+	counters are ordered by priority, unavailable ones are ignored.
+	*/
+	SamplingController (const CounterSet& available,
+		const std::vector<std::string>& counters,
+		const SamplingConfig& config = SamplingConfig ());
+	~SamplingController ();
+
+	/**
+	Call at the start of every frame. If the plan says so, profile this frame
+	using plan.passCount passes.
+	*/
+	SamplingPlan BeginFrame ();
+	SamplingPlan BeginFrame (const std::chrono::steady_clock::time_point now);
+
+	/**
+	Enable the counter set chosen by the controller, if it has chosen another
+	one. Returns whether the counters changed.
+	*/
+	bool ApplyPendingStep ();
+
+	void AddOverhead (const std::chrono::steady_clock::duration duration);
+
+	/**
+	Estimated fraction of frame time spent on profiling.
+	*/
+	double GetOverhead () const;
+
+	class ScopedOverhead
+	{
+	public:
+		ScopedOverhead (const ScopedOverhead& other) = delete;
+		ScopedOverhead& operator= (const ScopedOverhead& other) = delete;
+
+		explicit ScopedOverhead (SamplingController& controller);
+		~ScopedOverhead ();
+
+	private:
+		SamplingController&						controller_;
+		std::chrono::steady_clock::time_point	start_;
+	};
+
+private:
+	struct Impl;
+	Impl*	impl_;
+};
+}
+
+#endif
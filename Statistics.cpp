@@ -0,0 +1,101 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace Amd {
+////////////////////////////////////////////////////////////////////////////////
+double Mean (const std::vector<double>& values)
+{
+	double sum = 0;
+	for (const auto v : values) {
+		sum += v;
+	}
+	return values.empty () ? 0 : sum / values.size ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double MannWhitneyP (const std::vector<double>& a, const std::vector<double>& b)
+{
+	const double n1 = static_cast<double> (a.size ());
+	const double n2 = static_cast<double> (b.size ());
+	const double n = n1 + n2;
+
+	std::vector<std::pair<double, int>> all;
+	all.reserve (a.size () + b.size ());
+	for (const auto v : a) {
+		all.emplace_back (v, 0);
+	}
+	for (const auto v : b) {
+		all.emplace_back (v, 1);
+	}
+	std::sort (all.begin (), all.end ());
+
+	// Rank with ties receiving the average rank
+	double rankSumA = 0;
+	double tieCorrection = 0;
+
+	for (std::size_t i = 0; i < all.size ();) {
+		std::size_t j = i;
+		while (j < all.size () && all [j].first == all [i].first) {
+			++j;
+		}
+
+		const double rank = (i + 1 + j) / 2.0;
+		for (std::size_t k = i; k < j; ++k) {
+			if (all [k].second == 0) {
+				rankSumA += rank;
+			}
+		}
+
+		const double t = static_cast<double> (j - i);
+		tieCorrection += t * t * t - t;
+		i = j;
+	}
+
+	const double u = rankSumA - n1 * (n1 + 1) / 2;
+	const double mean = n1 * n2 / 2;
+	const double variance = n1 * n2 / 12 * ((n + 1) - tieCorrection / (n * (n - 1)));
+
+	if (variance <= 0) {
+		// All values identical
+		return 1;
+	}
+
+	// Normal approximation with continuity correction
+	const double z = std::max (0.0, std::abs (u - mean) - 0.5) / std::sqrt (variance);
+	return std::erfc (z / std::sqrt (2.0));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double BootstrapP (const std::vector<double>& a, const std::vector<double>& b,
+	const int iterations, const std::uint64_t seed)
+{
+	std::mt19937_64 random (seed);
+	std::uniform_int_distribution<std::size_t> pickA (0, a.size () - 1);
+	std::uniform_int_distribution<std::size_t> pickB (0, b.size () - 1);
+
+	int below = 0, above = 0;
+
+	for (int i = 0; i < iterations; ++i) {
+		double sumA = 0, sumB = 0;
+		for (std::size_t j = 0; j < a.size (); ++j) {
+			sumA += a [pickA (random)];
+		}
+		for (std::size_t j = 0; j < b.size (); ++j) {
+			sumB += b [pickB (random)];
+		}
+
+		const double delta = sumB / b.size () - sumA / a.size ();
+		if (delta <= 0) {
+			++below;
+		}
+		if (delta >= 0) {
+			++above;
+		}
+	}
+
+	return std::min (1.0, 2.0 * std::min (below, above) / iterations);
+}
+}
@@ -0,0 +1,25 @@
+#ifndef NIV_AMD_PERF_LIB_STATISTICS_H_3A9F5C12_8E4B_4D07_B6A1_52C7E0D94F38
+#define NIV_AMD_PERF_LIB_STATISTICS_H_3A9F5C12_8E4B_4D07_B6A1_52C7E0D94F38
+
+#include <cstdint>
+#include <vector>
+
+namespace Amd {
+double Mean (const std::vector<double>& values);
+
+/**
+Two-sided p-value of the Mann-Whitney U test, using the normal approximation
+with tie and continuity correction. Returns 1 if all values are identical.
+*/
+double MannWhitneyP (const std::vector<double>& a, const std::vector<double>& b);
+
+/**
+Two-sided p-value for a difference of the means, estimated by resampling a
+and b independently. Both must be non-empty. The result is deterministic for
+a given seed.
+*/
+double BootstrapP (const std::vector<double>& a, const std::vector<double>& b,
+	const int iterations, const std::uint64_t seed);
+}
+
+#endif
@@ -0,0 +1,194 @@
+// Records against GPUPerfAPIStub, then replays without loading it.
+
+#include "PerfLib.h"
+#include "Test.h"
+
+#include "GPUPerfAPITypes.h"
+
+#if AMD_PERF_API_LINUX
+#include <dlfcn.h>
+#endif
+
+namespace {
+const char* LogFile = "CallLogTest.aplr";
+
+// 70 counters need two passes in the stub
+const int CounterCount = 70;
+
+struct Recording
+{
+	std::vector<std::string>		counters;
+	int								passCount;
+	std::vector<Amd::SessionResult>	results;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsEqual (const Amd::ResultEntry& a, const Amd::ResultEntry& b)
+{
+	if (a.dataType != b.dataType) {
+		return false;
+	}
+
+	switch (a.dataType) {
+	case Amd::DataType::float32:	return a.f32 == b.f32;
+	case Amd::DataType::float64:	return a.f64 == b.f64;
+	case Amd::DataType::uint32:		return a.u32 == b.u32;
+	case Amd::DataType::uint64:		return a.u64 == b.u64;
+	case Amd::DataType::int32:		return a.i32 == b.i32;
+	case Amd::DataType::int64:		return a.i64 == b.i64;
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsEqual (const Amd::SessionResult& a, const Amd::SessionResult& b)
+{
+	if (a.size () != b.size ()) {
+		return false;
+	}
+
+	for (auto i = a.begin (), j = b.begin (); i != a.end (); ++i, ++j) {
+		if (i->first != j->first || !IsEqual (i->second, j->second)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+Profile one session with two samples in every pass. firstSampleId is only
+changed to make the replay diverge.
+*/
+Recording Run (Amd::PerformanceLibrary& library, const std::uint32_t firstSampleId)
+{
+	static int dummyContext;
+	auto context = library.OpenContext (&dummyContext);
+
+	Recording result;
+	auto counters = context.GetAvailableCounters ();
+
+	for (const auto& kv : counters) {
+		if (result.counters.size () < CounterCount) {
+			result.counters.push_back (kv.first);
+		}
+	}
+
+	counters.Keep (result.counters);
+	counters.Enable ();
+	result.passCount = counters.GetRequiredPassCount ();
+
+	auto session = context.BeginSession ();
+
+	for (int i = 0; i < result.passCount; ++i) {
+		auto pass = session.BeginPass ();
+		pass.BeginSample (firstSampleId).End ();
+		pass.BeginSample (1).End ();
+		pass.End ();
+	}
+
+	session.End ();
+
+	result.results.push_back (session.GetSampleResult (0, true));
+	result.results.push_back (session.GetSampleResult (1, true));
+
+	counters.Disable ();
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsStubLoaded ()
+{
+#if AMD_PERF_API_LINUX
+	void* lib = ::dlopen ("libGPUPerfAPICL.so", RTLD_NOW | RTLD_NOLOAD);
+
+	if (lib) {
+		::dlclose (lib);
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestRecordAndReplay ()
+{
+	Recording recorded;
+
+	{
+		Amd::PerformanceLibrary library (Amd::ProfileApi::OpenCL,
+			Amd::LibraryMode::Record, LogFile);
+		recorded = Run (library, 0);
+	}
+
+	NIV_CHECK (recorded.counters.size () == CounterCount);
+	NIV_CHECK (recorded.passCount == 2);
+	NIV_CHECK (recorded.results [0].size () == CounterCount);
+
+	Amd::PerformanceLibrary library (Amd::ProfileApi::OpenCL,
+		Amd::LibraryMode::Replay, LogFile);
+	NIV_CHECK (!IsStubLoaded ());
+
+	const auto replayed = Run (library, 0);
+
+	NIV_CHECK (replayed.counters == recorded.counters);
+	NIV_CHECK (replayed.passCount == recorded.passCount);
+	NIV_CHECK (replayed.results.size () == recorded.results.size ());
+	NIV_CHECK (IsEqual (replayed.results [0], recorded.results [0]));
+	NIV_CHECK (IsEqual (replayed.results [1], recorded.results [1]));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestDivergingReplay ()
+{
+	{
+		Amd::PerformanceLibrary library (Amd::ProfileApi::OpenCL,
+			Amd::LibraryMode::Replay, LogFile);
+		NIV_CHECK_THROWS (Run (library, 2));
+	}
+
+	// Once diverged, every call fails, including polling for readiness
+	Amd::PerformanceLibrary library (Amd::ProfileApi::OpenCL,
+		Amd::LibraryMode::Replay, LogFile);
+
+	static int dummyContext;
+	auto context = library.OpenContext (&dummyContext);
+	auto counters = context.GetAvailableCounters ();
+	std::vector<std::string> names;
+
+	for (const auto& kv : counters) {
+		if (names.size () < CounterCount) {
+			names.push_back (kv.first);
+		}
+	}
+
+	counters.Keep (names);
+	counters.Enable ();
+	counters.GetRequiredPassCount ();
+
+	auto session = context.BeginSession ();
+	auto pass = session.BeginPass ();
+
+	Amd::Sample sample;
+	NIV_CHECK (pass.TryBeginSample (2, sample) == GPA_STATUS_ERROR_FAILED);
+	NIV_CHECK (pass.TryEnd () == GPA_STATUS_ERROR_FAILED);
+
+	bool ready = true;
+	NIV_CHECK (session.TryIsReady (ready) == GPA_STATUS_ERROR_FAILED);
+}
+}
+
+int main ()
+{
+	try {
+		TestRecordAndReplay ();
+		TestDivergingReplay ();
+	} catch (const std::exception& e) {
+		::fprintf (stderr, "%s\n", e.what ());
+		return 1;
+	}
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,224 @@
+#include "CaptureQuery.h"
+#include "Test.h"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+const char* const Filename = "CaptureQueryTest.aplc";
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsNear (const double value, const double expected)
+{
+	// Buckets are 1% wide
+	return std::abs (value - expected) <= std::abs (expected) * 0.01;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Amd::CounterSet MakeCounters ()
+{
+	Amd::CounterSet::CounterMap counters;
+
+	Amd::Counter counter;
+	counter.index = 0;
+	counter.type = Amd::DataType::float64;
+	counter.usage = Amd::UsageType::Milliseconds;
+	counters ["GPUTime"] = counter;
+
+	counter.index = 1;
+	counter.type = Amd::DataType::uint64;
+	counter.usage = Amd::UsageType::Bytes;
+	counters ["FetchSize"] = counter;
+
+	return Amd::CounterSet (nullptr, counters);
+}
+
+/**
+Ten frames of scope 7 "shadow" and scope 8, which has no name. GPUTime is
+frame + 1 in scope 7 and -(frame + 1) in scope 8, FetchSize is 100 in both.
+*/
+void WriteCapture (const std::string& build)
+{
+	Amd::CaptureWriter writer (Filename, MakeCounters (), build);
+	writer.SetScopeName (7, "shadow");
+
+	for (std::uint64_t frame = 0; frame < 10; ++frame) {
+		for (std::uint32_t scope = 7; scope <= 8; ++scope) {
+			Amd::SessionResult result;
+
+			Amd::ResultEntry time;
+			time.dataType = Amd::DataType::float64;
+			time.f64 = (scope == 7 ? 1.0 : -1.0) * static_cast<double> (frame + 1);
+			result ["GPUTime"] = time;
+
+			Amd::ResultEntry size;
+			size.dataType = Amd::DataType::uint64;
+			size.u64 = 100;
+			result ["FetchSize"] = size;
+
+			writer.Write (frame, scope, result);
+		}
+	}
+
+	// Not finite, skipped
+	Amd::SessionResult result;
+	Amd::ResultEntry time;
+	time.dataType = Amd::DataType::float64;
+	time.f64 = std::numeric_limits<double>::quiet_NaN ();
+	result ["GPUTime"] = time;
+	writer.Write (10, 7, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Amd::QueryAggregates Scan (const Amd::QueryFilter& filter)
+{
+	Amd::CaptureReader reader (Filename);
+	const auto counters = Amd::SelectCounters (reader, filter);
+
+	Amd::QueryAggregates result;
+	Amd::ScanCapture (reader, counters, 0, reader.GetRecordCount (), filter, result);
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestPercentiles ()
+{
+	Amd::Histogram empty;
+	NIV_CHECK (empty.GetPercentile (50, 0) == 0);
+
+	Amd::Histogram histogram;
+	for (int i = 1; i <= 100; ++i) {
+		histogram.Add (i);
+	}
+
+	NIV_CHECK (IsNear (histogram.GetPercentile (0, 100), 1));
+	NIV_CHECK (IsNear (histogram.GetPercentile (50, 100), 50));
+	NIV_CHECK (IsNear (histogram.GetPercentile (90, 100), 90));
+	NIV_CHECK (IsNear (histogram.GetPercentile (99, 100), 99));
+	NIV_CHECK (IsNear (histogram.GetPercentile (100, 100), 100));
+
+	// Merging is the same as adding all values to one histogram
+	Amd::Histogram lower;
+	Amd::Histogram upper;
+	for (int i = 1; i <= 100; ++i) {
+		(i <= 50 ? lower : upper).Add (i);
+	}
+
+	lower.Merge (upper);
+	NIV_CHECK (lower.GetPercentile (50, 100) == histogram.GetPercentile (50, 100));
+	NIV_CHECK (lower.GetPercentile (90, 100) == histogram.GetPercentile (90, 100));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestNegativeAndZero ()
+{
+	Amd::Histogram histogram;
+	histogram.Add (-1000);
+	histogram.Add (-0.5);
+	histogram.Add (0);
+	histogram.Add (0);
+	histogram.Add (0.5);
+	histogram.Add (1000);
+
+	// Negative values are ordered by value, not magnitude
+	NIV_CHECK (IsNear (histogram.GetPercentile (0, 6), -1000));
+	NIV_CHECK (IsNear (histogram.GetPercentile (33, 6), -0.5));
+	NIV_CHECK (histogram.GetPercentile (50, 6) == 0);
+	NIV_CHECK (histogram.GetPercentile (60, 6) == 0);
+	NIV_CHECK (IsNear (histogram.GetPercentile (80, 6), 0.5));
+	NIV_CHECK (IsNear (histogram.GetPercentile (100, 6), 1000));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestGroups ()
+{
+	WriteCapture ("build-1");
+
+	Amd::QueryFilter filter;
+	const auto all = Scan (filter);
+
+	// Grouped by build, scope and counter; unnamed scopes are "#<scope>"
+	NIV_CHECK (all.size () == 4);
+
+	const Amd::QueryKey shadowTime ("build-1", "shadow", "GPUTime");
+	const Amd::QueryKey otherTime ("build-1", "#8", "GPUTime");
+	const Amd::QueryKey shadowSize ("build-1", "shadow", "FetchSize");
+
+	NIV_CHECK (all.count (shadowTime) && all.at (shadowTime).count == 10);
+	NIV_CHECK (all.count (shadowTime) && all.at (shadowTime).sum == 55);
+	NIV_CHECK (all.count (otherTime) && all.at (otherTime).sum == -55);
+	NIV_CHECK (all.count (otherTime)
+		&& IsNear (all.at (otherTime).histogram.GetPercentile (100, 10), -1));
+	NIV_CHECK (all.count (shadowSize) && all.at (shadowSize).sum == 1000);
+
+	// Scanning in chunks and merging gives the same groups
+	{
+		Amd::CaptureReader reader (Filename);
+		const auto counters = Amd::SelectCounters (reader, filter);
+		const auto half = reader.GetRecordCount () / 2;
+
+		Amd::QueryAggregates first;
+		Amd::QueryAggregates second;
+		Amd::ScanCapture (reader, counters, 0, half, filter, first);
+		Amd::ScanCapture (reader, counters, half, reader.GetRecordCount (), filter, second);
+
+		for (const auto& kv : second) {
+			first [kv.first].Merge (kv.second);
+		}
+
+		NIV_CHECK (first.size () == 4);
+		NIV_CHECK (first [shadowTime].count == 10);
+		NIV_CHECK (first [shadowTime].sum == 55);
+		NIV_CHECK (first [shadowTime].histogram.GetPercentile (50, 10)
+			== all.at (shadowTime).histogram.GetPercentile (50, 10));
+	}
+
+	filter.scopes.push_back ("shadow");
+	filter.counters.push_back ("GPUTime");
+	filter.firstFrame = 2;
+	filter.lastFrame = 5;
+	const auto filtered = Scan (filter);
+
+	// Frames 2 to 5 have GPUTime 3 to 6
+	NIV_CHECK (filtered.size () == 1);
+	NIV_CHECK (filtered.count (shadowTime) && filtered.at (shadowTime).count == 4);
+	NIV_CHECK (filtered.count (shadowTime) && filtered.at (shadowTime).sum == 18);
+
+	// Unnamed scopes can be selected by number
+	filter.scopes.assign (1, "#8");
+	NIV_CHECK (Scan (filter).count (otherTime) == 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestBuilds ()
+{
+	Amd::QueryFilter filter;
+	Amd::QueryAggregates aggregates;
+
+	for (const char* build : { "build-1", "build-2" }) {
+		WriteCapture (build);
+
+		Amd::CaptureReader reader (Filename);
+		Amd::ScanCapture (reader, Amd::SelectCounters (reader, filter),
+			0, reader.GetRecordCount (), filter, aggregates);
+	}
+
+	NIV_CHECK (aggregates.size () == 8);
+	NIV_CHECK (aggregates [Amd::QueryKey ("build-2", "shadow", "GPUTime")].count == 10);
+}
+}
+
+int main ()
+{
+	try {
+		TestPercentiles ();
+		TestNegativeAndZero ();
+		TestGroups ();
+		TestBuilds ();
+	} catch (const std::exception& e) {
+		::fprintf (stderr, "%s\n", e.what ());
+		return 1;
+	}
+
+	return NIV_TEST_RESULT ();
+}
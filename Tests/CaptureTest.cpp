@@ -0,0 +1,178 @@
+#include "Capture.h"
+#include "Test.h"
+
+#include <fstream>
+#include <sstream>
+#include <string.h>
+
+namespace {
+const char* const Filename = "CaptureTest.aplc";
+
+////////////////////////////////////////////////////////////////////////////////
+Amd::CounterSet MakeCounters ()
+{
+	Amd::CounterSet::CounterMap counters;
+
+	Amd::Counter counter;
+	counter.index = 0;
+	counter.type = Amd::DataType::float64;
+	counter.usage = Amd::UsageType::Milliseconds;
+	counters ["GPUTime"] = counter;
+
+	counter.index = 1;
+	counter.type = Amd::DataType::uint64;
+	counter.usage = Amd::UsageType::Bytes;
+	counters ["FetchSize"] = counter;
+
+	return Amd::CounterSet (nullptr, counters);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteCapture (const std::uint64_t frames)
+{
+	Amd::CaptureWriter writer (Filename, MakeCounters (), "build-1");
+	writer.SetScopeName (7, "shadow");
+
+	for (std::uint64_t frame = 0; frame < frames; ++frame) {
+		Amd::SessionResult result;
+
+		Amd::ResultEntry time;
+		time.dataType = Amd::DataType::float64;
+		time.f64 = 1.5 * frame;
+		result ["GPUTime"] = time;
+
+		Amd::ResultEntry size;
+		size.dataType = Amd::DataType::uint64;
+		size.u64 = 1000 + frame;
+		result ["FetchSize"] = size;
+
+		writer.Write (frame, 7, result);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string ReadFile ()
+{
+	std::ifstream file (Filename, std::ios::binary);
+	std::stringstream result;
+	result << file.rdbuf ();
+	return result.str ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteFile (const std::string& contents)
+{
+	std::ofstream file (Filename, std::ios::binary | std::ios::trunc);
+	file.write (contents.data (), contents.size ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestRoundTrip ()
+{
+	WriteCapture (3);
+
+	Amd::CaptureReader reader (Filename);
+
+	NIV_CHECK (reader.GetBuild () == "build-1");
+	NIV_CHECK (reader.GetCounters ().size () == 2);
+	NIV_CHECK (reader.GetCounters () [0].name == "FetchSize");
+	NIV_CHECK (reader.GetCounters () [1].name == "GPUTime");
+	NIV_CHECK (reader.GetCounters () [1].type == Amd::DataType::float64);
+	NIV_CHECK (reader.IsClosed ());
+	NIV_CHECK (reader.GetScopeName (7) == "shadow");
+	NIV_CHECK (reader.GetScopeName (8) == "#8");
+	NIV_CHECK (reader.GetRecordCount () == 6);
+
+	const auto record = reader.GetRecord (5);
+	NIV_CHECK (record.frame == 2);
+	NIV_CHECK (record.scope == 7);
+	NIV_CHECK (record.counter == 1);
+	NIV_CHECK (reader.GetValue (record) == 3.0);
+	NIV_CHECK (reader.GetValue (reader.GetRecord (4)) == 1002.0);
+
+	NIV_CHECK_THROWS (reader.GetRecord (6));
+
+	Amd::CaptureRecord invalid = record;
+	invalid.counter = 2;
+	NIV_CHECK_THROWS (reader.GetValue (invalid));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestUnclosedCapture ()
+{
+	WriteCapture (3);
+
+	// Cut off the trailer and half of the last record, as if the writer crashed
+	auto contents = ReadFile ();
+	std::uint64_t trailerOffset = 0;
+	::memcpy (&trailerOffset, contents.data () + contents.size () - 12, 8);
+	contents.resize (static_cast<std::size_t> (trailerOffset) - 10);
+	WriteFile (contents);
+
+	Amd::CaptureReader reader (Filename);
+
+	NIV_CHECK (reader.GetRecordCount () == 5);
+	NIV_CHECK (!reader.IsClosed ());
+	NIV_CHECK (reader.GetScopeName (7) == "#7");
+	NIV_CHECK (reader.GetRecord (4).frame == 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestCorruptCaptures ()
+{
+	WriteCapture (3);
+	const auto contents = ReadFile ();
+
+	std::uint64_t recordOffset = 0;
+	::memcpy (&recordOffset, contents.data () + 8, 8);
+
+	// Not a capture
+	WriteFile ("APLX");
+	NIV_CHECK_THROWS (Amd::CaptureReader reader (Filename));
+
+	// Truncated inside the header
+	WriteFile (contents.substr (0, 20));
+	NIV_CHECK_THROWS (Amd::CaptureReader reader (Filename));
+
+	// Record offset beyond the end of the file
+	auto corrupt = contents;
+	const std::uint64_t largeOffset = contents.size () + 1;
+	::memcpy (&corrupt [8], &largeOffset, 8);
+	WriteFile (corrupt);
+	NIV_CHECK_THROWS (Amd::CaptureReader reader (Filename));
+
+	// Trailer in front of the records
+	corrupt = contents;
+	const std::uint64_t trailerOffset = recordOffset - 8;
+	::memcpy (&corrupt [corrupt.size () - 12], &trailerOffset, 8);
+	WriteFile (corrupt);
+	NIV_CHECK_THROWS (Amd::CaptureReader reader (Filename));
+
+	// Trailer beyond the end of the file
+	corrupt = contents;
+	const std::uint64_t lateOffset = contents.size () + 100;
+	::memcpy (&corrupt [corrupt.size () - 12], &lateOffset, 8);
+	WriteFile (corrupt);
+	NIV_CHECK_THROWS (Amd::CaptureReader reader (Filename));
+
+	// Scope count larger than the trailer
+	corrupt = contents;
+	std::uint64_t realTrailerOffset = 0;
+	::memcpy (&realTrailerOffset, contents.data () + contents.size () - 12, 8);
+	const std::uint32_t scopeCount = 1000;
+	::memcpy (&corrupt [static_cast<std::size_t> (realTrailerOffset)], &scopeCount, 4);
+	WriteFile (corrupt);
+	NIV_CHECK_THROWS (Amd::CaptureReader reader (Filename));
+
+	NIV_CHECK_THROWS (Amd::CaptureReader reader ("CaptureTest.missing"));
+}
+}
+
+int main ()
+{
+	TestRoundTrip ();
+	TestUnclosedCapture ();
+	TestCorruptCaptures ();
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,218 @@
+// Runs against GPUPerfAPIStub, using GPAStub_InjectFailure to make calls fail.
+
+#include "PerfLib.h"
+#include "Test.h"
+
+#include "GPUPerfAPITypes.h"
+
+#if AMD_PERF_API_LINUX
+#include <dlfcn.h>
+#elif AMD_PERF_API_WINDOWS
+#include <Windows.h>
+#endif
+
+namespace {
+typedef void (*InjectFailurePtr) (const char* function, GPA_Status status);
+
+////////////////////////////////////////////////////////////////////////////////
+InjectFailurePtr GetInjectFailure ()
+{
+	// The stub has been loaded by PerformanceLibrary already
+#if AMD_PERF_API_LINUX
+	void* lib = ::dlopen ("libGPUPerfAPICL.so", RTLD_NOW | RTLD_NOLOAD);
+
+	if (lib == nullptr) {
+		return nullptr;
+	}
+
+	auto result = reinterpret_cast<InjectFailurePtr> (::dlsym (lib, "GPAStub_InjectFailure"));
+	::dlclose (lib);
+	return result;
+#elif AMD_PERF_API_WINDOWS
+#if AMD_PERF_API_X64
+	HMODULE lib = ::GetModuleHandleA ("GPUPerfAPICL-x64.dll");
+#else
+	HMODULE lib = ::GetModuleHandleA ("GPUPerfAPICL.dll");
+#endif
+
+	if (lib == nullptr) {
+		return nullptr;
+	}
+
+	return reinterpret_cast<InjectFailurePtr> (::GetProcAddress (lib, "GPAStub_InjectFailure"));
+#else
+	return nullptr;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<Amd::ErrorRecord> DrainAll (Amd::Context& context)
+{
+	Amd::ErrorRecord records [128];
+	const auto count = context.DrainErrors (records, 128);
+	return std::vector<Amd::ErrorRecord> (records, records + count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsRecord (const Amd::ErrorRecord& record, const int code, const std::string& operation)
+{
+	return record.code == code && operation == record.operation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestLifecycle (Amd::PerformanceLibrary& library, Amd::Context& context)
+{
+	static int dummyContext;
+	NIV_CHECK (library.TryOpenContext (&dummyContext, context) == GPA_STATUS_OK);
+
+	Amd::CounterSet counters;
+	NIV_CHECK (context.TryGetAvailableCounters (counters) == GPA_STATUS_OK);
+
+	std::vector<std::string> names;
+	names.push_back ("GPUTime");
+	names.push_back ("FetchSize");
+	counters.Keep (names);
+
+	int passCount = 0;
+	NIV_CHECK (counters.TryEnable () == GPA_STATUS_OK);
+	NIV_CHECK (counters.TryGetRequiredPassCount (passCount) == GPA_STATUS_OK);
+	NIV_CHECK (passCount == 1);
+
+	Amd::Session session;
+	NIV_CHECK (context.TryBeginSession (session) == GPA_STATUS_OK);
+	NIV_CHECK (session.IsActive ());
+
+	Amd::Pass pass;
+	NIV_CHECK (session.TryBeginPass (pass) == GPA_STATUS_OK);
+
+	Amd::Sample sample;
+	NIV_CHECK (pass.TryBeginSample (3, sample) == GPA_STATUS_OK);
+	NIV_CHECK (sample.IsActive ());
+	NIV_CHECK (sample.TryEnd () == GPA_STATUS_OK);
+	NIV_CHECK (pass.TryEnd () == GPA_STATUS_OK);
+	NIV_CHECK (session.TryEnd () == GPA_STATUS_OK);
+	NIV_CHECK (!session.IsActive ());
+
+	bool ready = false;
+	NIV_CHECK (session.TryIsReady (ready) == GPA_STATUS_OK);
+	NIV_CHECK (ready);
+
+	Amd::SessionResult result;
+	NIV_CHECK (session.TryGetSampleResult (3, true, result) == GPA_STATUS_OK);
+	NIV_CHECK (result.size () == 2);
+	NIV_CHECK (result.count ("GPUTime") == 1);
+
+	Amd::FrameResult frameResult;
+	NIV_CHECK (session.TryGetSampleResult (3, true, frameResult) == GPA_STATUS_OK);
+	NIV_CHECK (frameResult.size () == 2);
+
+	NIV_CHECK (counters.TryDisable () == GPA_STATUS_OK);
+	NIV_CHECK (DrainAll (context).empty ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestFailures (Amd::Context& context, const InjectFailurePtr injectFailure)
+{
+	auto counters = context.GetAvailableCounters ();
+	counters.Keep (std::vector<std::string> (1, "GPUTime"));
+	NIV_CHECK (counters.TryEnable () == GPA_STATUS_OK);
+	NIV_CHECK (counters.TryEnable () == GPA_STATUS_ERROR_ALREADY_ENABLED);
+
+	Amd::Session session;
+	NIV_CHECK (context.TryBeginSession (session) == GPA_STATUS_OK);
+
+	// A failed begin leaves the target untouched
+	Amd::Session other;
+	NIV_CHECK (context.TryBeginSession (other) == GPA_STATUS_ERROR_SAMPLING_ALREADY_STARTED);
+	NIV_CHECK (!other.IsActive ());
+
+	injectFailure ("GPA_BeginPass", GPA_STATUS_ERROR_FAILED);
+	Amd::Pass pass;
+	NIV_CHECK (session.TryBeginPass (pass) == GPA_STATUS_ERROR_FAILED);
+	NIV_CHECK (!pass.IsActive ());
+	NIV_CHECK (session.TryEnd () == GPA_STATUS_OK);
+
+	// Objects without a library only return the error
+	Amd::Sample sample;
+	NIV_CHECK (sample.TryEnd () == Amd::ErrorCode::InvalidObject);
+
+	const auto records = DrainAll (context);
+	NIV_CHECK (records.size () == 3);
+	NIV_CHECK (records.size () == 3 && IsRecord (records [0],
+		GPA_STATUS_ERROR_ALREADY_ENABLED, "GPA_EnableCounter"));
+	NIV_CHECK (records.size () == 3 && IsRecord (records [1],
+		GPA_STATUS_ERROR_SAMPLING_ALREADY_STARTED, "GPA_BeginSession"));
+	NIV_CHECK (records.size () == 3 && IsRecord (records [2],
+		GPA_STATUS_ERROR_FAILED, "GPA_BeginPass"));
+
+	NIV_CHECK (counters.TryDisable () == GPA_STATUS_OK);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestOverflow (Amd::Context& context)
+{
+	auto counters = context.GetAvailableCounters ();
+	counters.Keep (std::vector<std::string> (1, "GPUTime"));
+
+	// Each call fails on its only counter
+	for (int i = 0; i < 70; ++i) {
+		NIV_CHECK (counters.TryDisable () == GPA_STATUS_ERROR_NOT_ENABLED);
+	}
+
+	// Drained in parts, the overflow record comes last
+	Amd::ErrorRecord records [128];
+	NIV_CHECK (context.DrainErrors (records, 60) == 60);
+
+	const auto count = context.DrainErrors (records, 128);
+	NIV_CHECK (count == 5);
+	NIV_CHECK (IsRecord (records [0], GPA_STATUS_ERROR_NOT_ENABLED, "GPA_DisableCounter"));
+	NIV_CHECK (records [count - 1].code == Amd::ErrorCode::ErrorLogOverflow);
+
+	NIV_CHECK (DrainAll (context).empty ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestDestructorErrors (Amd::Context& context, const InjectFailurePtr injectFailure)
+{
+	auto counters = context.GetAvailableCounters ();
+	counters.Keep (std::vector<std::string> (1, "GPUTime"));
+	counters.Enable ();
+
+	{
+		auto session = context.BeginSession ();
+		auto pass = session.BeginPass ();
+		auto sample = pass.BeginSample (0);
+
+		injectFailure ("GPA_EndSample", GPA_STATUS_ERROR_FAILED);
+	}
+
+	const auto records = DrainAll (context);
+	NIV_CHECK (records.size () == 1);
+	NIV_CHECK (records.size () == 1 && IsRecord (records [0],
+		GPA_STATUS_ERROR_FAILED, "GPA_EndSample"));
+}
+}
+
+int main ()
+{
+	try {
+		Amd::PerformanceLibrary library (Amd::ProfileApi::OpenCL);
+		const auto injectFailure = GetInjectFailure ();
+
+		if (injectFailure == nullptr) {
+			::fprintf (stderr, "GPAStub_InjectFailure not found\n");
+			return 1;
+		}
+
+		Amd::Context context;
+		TestLifecycle (library, context);
+		TestFailures (context, injectFailure);
+		TestOverflow (context);
+		TestDestructorErrors (context, injectFailure);
+	} catch (const std::exception& e) {
+		::fprintf (stderr, "%s\n", e.what ());
+		return 1;
+	}
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,126 @@
+#include "FlightRecorder.h"
+#include "Test.h"
+
+#include <set>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+Amd::CounterSet MakeCounters ()
+{
+	Amd::CounterSet::CounterMap counters;
+
+	Amd::Counter counter;
+	counter.index = 0;
+	counter.type = Amd::DataType::float64;
+	counter.usage = Amd::UsageType::Milliseconds;
+	counters ["GPUTime"] = counter;
+
+	counter.index = 1;
+	counter.type = Amd::DataType::uint64;
+	counter.usage = Amd::UsageType::Bytes;
+	counters ["FetchSize"] = counter;
+
+	return Amd::CounterSet (nullptr, counters);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Amd::SessionResult MakeResult (const double time)
+{
+	Amd::SessionResult result;
+
+	Amd::ResultEntry entry;
+	entry.dataType = Amd::DataType::float64;
+	entry.f64 = time;
+	result ["GPUTime"] = entry;
+
+	entry.dataType = Amd::DataType::uint64;
+	entry.u64 = 1024;
+	result ["FetchSize"] = entry;
+
+	// Not part of the recorded counters
+	result ["Other"] = entry;
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::set<std::uint64_t> GetFrames (const Amd::CaptureReader& reader)
+{
+	std::set<std::uint64_t> result;
+
+	for (std::size_t i = 0; i < reader.GetRecordCount (); ++i) {
+		result.insert (reader.GetRecord (i).frame);
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestWindowInFrames ()
+{
+	Amd::FlightRecorderConfig config;
+	config.frames = 4;
+
+	Amd::FlightRecorder recorder ("FlightRecorderTestWindow", MakeCounters (), "build", config);
+	recorder.SetScopeName (2, "shadow");
+
+	// Three scopes per frame, more values than preallocated for one
+	for (std::uint64_t frame = 0; frame < 10; ++frame) {
+		for (std::uint32_t scope = 0; scope < 3; ++scope) {
+			recorder.Record (frame, scope, MakeResult (1));
+		}
+	}
+
+	recorder.Dump ();
+	recorder.Flush ();
+	NIV_CHECK (recorder.GetDumpCount () == 1);
+
+	Amd::CaptureReader reader ("FlightRecorderTestWindow0.aplc");
+	NIV_CHECK (reader.GetBuild () == "build");
+	NIV_CHECK (reader.GetRecordCount () == 4 * 3 * 2);
+	NIV_CHECK (GetFrames (reader) == (std::set<std::uint64_t> { 6, 7, 8, 9 }));
+	NIV_CHECK (reader.GetScopeName (2) == "shadow");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestTrigger ()
+{
+	Amd::FlightRecorderConfig config;
+	config.frames = 4;
+	config.postTriggerFrames = 1;
+
+	Amd::FlightRecorder recorder ("FlightRecorderTestTrigger", MakeCounters (), "build", config);
+	recorder.SetTrigger (Amd::FlightRecorder::Above ("GPUTime", 100));
+
+	for (std::uint64_t frame = 0; frame < 20; ++frame) {
+		recorder.Record (frame, 0, MakeResult (frame == 12 ? 200 : 1));
+		recorder.Record (frame, 1, MakeResult (1));
+	}
+
+	recorder.Flush ();
+	NIV_CHECK (recorder.GetDumpCount () == 1);
+	NIV_CHECK (recorder.GetDroppedDumpCount () == 0);
+
+	// Taken once the frame after the trigger is complete
+	Amd::CaptureReader reader ("FlightRecorderTestTrigger0.aplc");
+	NIV_CHECK (GetFrames (reader) == (std::set<std::uint64_t> { 10, 11, 12, 13 }));
+	NIV_CHECK (reader.GetRecordCount () == 4 * 2 * 2);
+
+	// Dumps requested while one is written are counted
+	for (int i = 0; i < 50; ++i) {
+		recorder.Dump ();
+	}
+
+	recorder.Flush ();
+	NIV_CHECK (recorder.GetDumpCount () >= 2);
+	NIV_CHECK (recorder.GetDumpCount () + recorder.GetDroppedDumpCount () == 51);
+}
+}
+
+int main ()
+{
+	TestWindowInFrames ();
+	TestTrigger ();
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,170 @@
+#include "PerfLib.h"
+#include "Test.h"
+
+#include <cstdint>
+
+namespace {
+/**
+Forwards to the default resource at construction and counts the calls.
+*/
+class CountingResource : public Amd::MemoryResource
+{
+public:
+	CountingResource ()
+	: allocations (0)
+	, deallocations (0)
+	, bytes (0)
+	, upstream_ (Amd::GetDefaultResource ())
+	{
+	}
+
+	void* Allocate (const std::size_t size, const std::size_t alignment) override
+	{
+		++allocations;
+		bytes += size;
+		return upstream_->Allocate (size, alignment);
+	}
+
+	void Deallocate (void* p, const std::size_t size,
+		const std::size_t alignment) override
+	{
+		++deallocations;
+		bytes -= size;
+		upstream_->Deallocate (p, size, alignment);
+	}
+
+	int						allocations;
+	int						deallocations;
+	std::size_t				bytes;
+
+private:
+	Amd::MemoryResource*	upstream_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsAligned (const void* p, const std::size_t alignment)
+{
+	return reinterpret_cast<std::uintptr_t> (p) % alignment == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestArenaAllocation ()
+{
+	CountingResource upstream;
+
+	{
+		Amd::FrameArena arena (1024, &upstream);
+		NIV_CHECK (arena.GetCapacity () == 0);
+
+		char* a = static_cast<char*> (arena.Allocate (3, 1));
+		char* b = static_cast<char*> (arena.Allocate (8, 8));
+		char* c = static_cast<char*> (arena.Allocate (64, 64));
+
+		NIV_CHECK (IsAligned (b, 8));
+		NIV_CHECK (IsAligned (c, 64));
+		NIV_CHECK (b >= a + 3);
+		NIV_CHECK (c >= b + 8);
+		NIV_CHECK (upstream.allocations == 1);
+		NIV_CHECK (arena.GetCapacity () == 1024);
+
+		// Larger than a block
+		void* large = arena.Allocate (4096, 16);
+		NIV_CHECK (IsAligned (large, 16));
+		NIV_CHECK (upstream.allocations == 2);
+
+		// Spills into a new block
+		for (int i = 0; i < 64; ++i) {
+			arena.Allocate (32, 8);
+		}
+
+		const auto capacity = arena.GetCapacity ();
+		const auto allocations = upstream.allocations;
+		NIV_CHECK (allocations == 4);
+
+		// Same allocations after a reset reuse the blocks
+		for (int frame = 0; frame < 8; ++frame) {
+			arena.Reset ();
+
+			arena.Allocate (3, 1);
+			arena.Allocate (8, 8);
+			arena.Allocate (64, 64);
+			arena.Allocate (4096, 16);
+
+			for (int i = 0; i < 64; ++i) {
+				arena.Allocate (32, 8);
+			}
+		}
+
+		NIV_CHECK (upstream.allocations == allocations);
+		NIV_CHECK (arena.GetCapacity () == capacity);
+
+		// Deallocate does nothing
+		arena.Deallocate (c, 64, 64);
+		NIV_CHECK (upstream.deallocations == 0);
+	}
+
+	NIV_CHECK (upstream.deallocations == upstream.allocations);
+	NIV_CHECK (upstream.bytes == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestFrameResult ()
+{
+	CountingResource upstream;
+	Amd::FrameArena arena (4096, &upstream);
+
+	Amd::ResultEntry entry;
+	entry.dataType = Amd::DataType::uint64;
+	entry.u64 = 42;
+
+	for (int frame = 0; frame < 4; ++frame) {
+		{
+			Amd::FrameResult result (&arena);
+			result.emplace (std::piecewise_construct,
+				std::forward_as_tuple ("ALongCounterNameWhichIsNotStoredInline", result.get_allocator ()),
+				std::forward_as_tuple (entry));
+
+			NIV_CHECK (result.begin ()->first.get_allocator ().GetResource () == &arena);
+			NIV_CHECK (result.begin ()->second.u64 == 42);
+
+			// Copies fall back to the default resource
+			Amd::FrameResult copy (result);
+			NIV_CHECK (copy.get_allocator ().GetResource () == Amd::GetDefaultResource ());
+		}
+
+		arena.Reset ();
+	}
+
+	NIV_CHECK (upstream.allocations == 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestDefaultResource ()
+{
+	CountingResource resource;
+
+	NIV_CHECK (Amd::SetDefaultResource (&resource) != &resource);
+	NIV_CHECK (Amd::GetDefaultResource () == &resource);
+
+	{
+		Amd::FrameResult result;
+		result [Amd::String ("GPUTime")].u64 = 1;
+		NIV_CHECK (resource.allocations > 0);
+	}
+
+	NIV_CHECK (resource.deallocations == resource.allocations);
+
+	// Restore the initial resource
+	NIV_CHECK (Amd::SetDefaultResource (nullptr) == &resource);
+	NIV_CHECK (Amd::GetDefaultResource () != &resource);
+}
+}
+
+int main ()
+{
+	TestArenaAllocation ();
+	TestFrameResult ();
+	TestDefaultResource ();
+
+	return NIV_TEST_RESULT ();
+}
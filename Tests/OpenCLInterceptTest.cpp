@@ -0,0 +1,129 @@
+// Runs with libAmdPerfIntercept.so preloaded, against the OpenCL stand-in
+// runtime and GPUPerfAPIStub; CTest sets LD_PRELOAD and the capture path.
+
+#include "Capture.h"
+#include "OpenCLTypes.h"
+#include "Test.h"
+
+#include <stdlib.h>
+
+#include <set>
+#include <thread>
+
+extern "C" cl_int clEnqueueNDRangeKernel (cl_command_queue queue,
+	cl_kernel kernel, cl_uint workDim, const std::size_t* globalWorkOffset,
+	const std::size_t* globalWorkSize, const std::size_t* localWorkSize,
+	cl_uint eventCount, const cl_event* eventWaitList, cl_event* event);
+extern "C" cl_int clReleaseKernel (cl_kernel kernel);
+extern "C" cl_int clReleaseCommandQueue (cl_command_queue queue);
+
+namespace {
+const int ProfiledEnqueues = 100;
+const int SessionSize = 16;
+
+////////////////////////////////////////////////////////////////////////////////
+cl_command_queue MakeQueue (int& storage)
+{
+	return reinterpret_cast<cl_command_queue> (&storage);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+cl_kernel MakeKernel (const char* name)
+{
+	return reinterpret_cast<cl_kernel> (const_cast<char*> (name));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+cl_int Enqueue (cl_command_queue queue, cl_kernel kernel)
+{
+	const std::size_t size = 64;
+	return clEnqueueNDRangeKernel (queue, kernel, 1, nullptr, &size, nullptr,
+		0, nullptr, nullptr);
+}
+}
+
+int main ()
+{
+	const char* capturePath = ::getenv ("AMD_PERF_CAPTURE");
+
+	if (capturePath == nullptr || ::getenv ("LD_PRELOAD") == nullptr) {
+		::fprintf (stderr, "Run through CTest, which preloads the interceptor\n");
+		return 1;
+	}
+
+	static const char* const names [] = { "blur", "sharpen", "reduce" };
+	int profiledStorage = 0;
+	const cl_command_queue profiled = MakeQueue (profiledStorage);
+
+	// The first queue used is profiled
+	for (int i = 0; i < ProfiledEnqueues; ++i) {
+		NIV_CHECK (Enqueue (profiled, MakeKernel (names [i % 3])) == CL_SUCCESS);
+	}
+
+	// Failed enqueues are passed through, but not recorded
+	NIV_CHECK (Enqueue (profiled, nullptr) == CL_INVALID_KERNEL);
+
+	// Other queues are passed through, also concurrently
+	std::vector<std::thread> threads;
+	std::vector<int> failures (4, 0);
+
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back ([&failures, t] () {
+			int storage = 0;
+			const cl_command_queue queue = MakeQueue (storage);
+
+			for (int i = 0; i < 1000; ++i) {
+				if (Enqueue (queue, MakeKernel (names [0])) != CL_SUCCESS) {
+					++failures [t];
+				}
+			}
+		});
+	}
+
+	for (auto& thread : threads) {
+		thread.join ();
+	}
+
+	for (const auto count : failures) {
+		NIV_CHECK (count == 0);
+	}
+
+	NIV_CHECK (clReleaseKernel (MakeKernel (names [2])) == CL_SUCCESS);
+
+	// Releasing the profiled queue reads back everything and closes the capture
+	NIV_CHECK (clReleaseCommandQueue (profiled) == CL_SUCCESS);
+
+	// Afterwards, enqueues are passed through
+	NIV_CHECK (Enqueue (profiled, MakeKernel (names [0])) == CL_SUCCESS);
+	NIV_CHECK (Enqueue (profiled, nullptr) == CL_INVALID_KERNEL);
+
+	Amd::CaptureReader reader (capturePath);
+
+	NIV_CHECK (reader.GetCounters ().size () == 1);
+	NIV_CHECK (reader.GetCounters () [0].name == "GPUTime");
+	NIV_CHECK (reader.GetRecordCount () == ProfiledEnqueues);
+
+	std::set<std::uint64_t> frames;
+	std::vector<int> perScope (3, 0);
+
+	for (std::size_t i = 0; i < reader.GetRecordCount (); ++i) {
+		const auto record = reader.GetRecord (i);
+		frames.insert (record.frame);
+
+		if (record.scope < perScope.size ()) {
+			++perScope [record.scope];
+		} else {
+			NIV_CHECK (record.scope < perScope.size ());
+		}
+	}
+
+	// Sessions are frames
+	NIV_CHECK (frames.size () == (ProfiledEnqueues + SessionSize - 1) / SessionSize);
+
+	for (std::uint32_t scope = 0; scope < 3; ++scope) {
+		NIV_CHECK (reader.GetScopeName (scope) == names [scope]);
+		NIV_CHECK (perScope [scope] == (ProfiledEnqueues + 2 - static_cast<int> (scope)) / 3);
+	}
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,228 @@
+#include "ResultPipeline.h"
+#include "Test.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+Amd::SessionResult MakeResult (const std::uint32_t sessionId, const int counters)
+{
+	Amd::SessionResult result;
+
+	for (int i = 0; i < counters; ++i) {
+		Amd::ResultEntry entry;
+		entry.dataType = Amd::DataType::uint64;
+		entry.u64 = sessionId * 100 + i;
+		result ["Counter" + std::to_string (i)] = entry;
+	}
+
+	return result;
+}
+
+/**
+Records commits, and checks that they happen one at a time and never on the
+submitting thread.
+*/
+struct Recorder
+{
+	Recorder ()
+	: submitter (std::this_thread::get_id ())
+	, committing (false)
+	, failures (0)
+	{
+	}
+
+	void Commit (const std::uint32_t sessionId, const std::uint32_t sampleId,
+		const Amd::SessionResult& result)
+	{
+		if (committing.exchange (true)) {
+			++failures;
+		}
+
+		if (std::this_thread::get_id () == submitter) {
+			++failures;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			commits.push_back (std::make_pair (sessionId, sampleId));
+			results.push_back (result);
+		}
+
+		committing = false;
+	}
+
+	Amd::ResultPipeline::Commit Get ()
+	{
+		return [this] (const std::uint32_t sessionId, const std::uint32_t sampleId,
+			const Amd::SessionResult& result) {
+			Commit (sessionId, sampleId, result);
+		};
+	}
+
+	std::thread::id											submitter;
+	std::atomic<bool>										committing;
+	std::atomic<int>										failures;
+
+	std::mutex												mutex;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>>	commits;
+	std::vector<Amd::SessionResult>							results;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void Double (const std::uint32_t sessionId, const std::uint32_t,
+	Amd::SessionResult& result)
+{
+	// Finish out of order
+	std::this_thread::sleep_for (std::chrono::microseconds ((sessionId * 7) % 5 * 50));
+
+	for (auto& kv : result) {
+		kv.second.u64 *= 2;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestOrder (const std::size_t counterBlockSize)
+{
+	Recorder recorder;
+
+	Amd::ResultPipelineConfig config;
+	config.threads = 4;
+	config.counterBlockSize = counterBlockSize;
+
+	const std::uint32_t sessions = 100;
+
+	{
+		Amd::ResultPipeline pipeline (&Double, recorder.Get (), config);
+
+		for (std::uint32_t i = 0; i < sessions; ++i) {
+			Amd::ResultPipeline::SampleResults samples;
+			samples.emplace_back (0, MakeResult (i, 10));
+			samples.emplace_back (1, MakeResult (i, 10));
+			pipeline.Submit (i, std::move (samples));
+		}
+
+		pipeline.Flush ();
+	}
+
+	NIV_CHECK (recorder.failures == 0);
+	NIV_CHECK (recorder.commits.size () == sessions * 2);
+
+	for (std::size_t i = 0; i < recorder.commits.size (); ++i) {
+		const auto sessionId = static_cast<std::uint32_t> (i / 2);
+		NIV_CHECK (recorder.commits [i].first == sessionId);
+		NIV_CHECK (recorder.commits [i].second == i % 2);
+
+		// Blocks are merged again
+		NIV_CHECK (recorder.results [i].size () == 10);
+		NIV_CHECK (recorder.results [i]["Counter3"].u64 == (sessionId * 100 + 3) * 2);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestEmptyResult ()
+{
+	for (std::size_t counterBlockSize = 0; counterBlockSize < 4; counterBlockSize += 3) {
+		Recorder recorder;
+
+		Amd::ResultPipelineConfig config;
+		config.threads = 2;
+		config.counterBlockSize = counterBlockSize;
+
+		Amd::ResultPipeline pipeline (&Double, recorder.Get (), config);
+		pipeline.Submit (0, 0, Amd::SessionResult ());
+		pipeline.Submit (1, 0, MakeResult (1, 4));
+		pipeline.Submit (2, 0, Amd::SessionResult ());
+		pipeline.Flush ();
+
+		// Committed by a worker, in order
+		NIV_CHECK (recorder.failures == 0);
+		NIV_CHECK (recorder.commits.size () == 3);
+		NIV_CHECK (recorder.commits [0].first == 0);
+		NIV_CHECK (recorder.commits [1].first == 1);
+		NIV_CHECK (recorder.commits [2].first == 2);
+		NIV_CHECK (recorder.results [0].empty ());
+		NIV_CHECK (recorder.results [1].size () == 4);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestErrors ()
+{
+	Recorder recorder;
+
+	Amd::ResultPipelineConfig config;
+	config.threads = 3;
+	config.counterBlockSize = 2;
+
+	Amd::ResultPipeline pipeline ([] (const std::uint32_t sessionId, const std::uint32_t,
+		Amd::SessionResult& result) {
+		if (sessionId == 5 && result.count ("Counter2")) {
+			throw std::runtime_error ("process");
+		}
+	}, recorder.Get (), config);
+
+	for (std::uint32_t i = 0; i < 10; ++i) {
+		pipeline.Submit (i, 0, MakeResult (i, 4));
+	}
+
+	NIV_CHECK_THROWS (pipeline.Flush ());
+
+	// The failed result is skipped, the others are committed
+	NIV_CHECK (recorder.commits.size () == 9);
+	for (const auto& commit : recorder.commits) {
+		NIV_CHECK (commit.first != 5);
+	}
+
+	// The error is reported once
+	pipeline.Flush ();
+
+	Amd::ResultPipeline failingCommit (&Double, [] (const std::uint32_t,
+		const std::uint32_t, const Amd::SessionResult&) {
+		throw std::runtime_error ("commit");
+	}, config);
+
+	failingCommit.Submit (0, 0, MakeResult (0, 4));
+	NIV_CHECK_THROWS (failingCommit.Flush ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestMaxPending ()
+{
+	Recorder recorder;
+	std::atomic<int> committed (0);
+
+	Amd::ResultPipelineConfig config;
+	config.threads = 2;
+	config.maxPending = 2;
+
+	Amd::ResultPipeline pipeline (&Double, [&] (const std::uint32_t sessionId,
+		const std::uint32_t sampleId, const Amd::SessionResult& result) {
+		recorder.Commit (sessionId, sampleId, result);
+		++committed;
+	}, config);
+
+	for (std::uint32_t i = 0; i < 20; ++i) {
+		pipeline.Submit (i, 0, MakeResult (i, 4));
+		NIV_CHECK (static_cast<int> (i + 1) - committed <= 2);
+	}
+
+	pipeline.Flush ();
+	NIV_CHECK (recorder.failures == 0);
+	NIV_CHECK (committed == 20);
+}
+}
+
+int main ()
+{
+	TestOrder (0);
+	TestOrder (3);
+	TestEmptyResult ();
+	TestErrors ();
+	TestMaxPending ();
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,203 @@
+// Runs against GPUPerfAPIStub, which fits 64 counters into a pass.
+
+#include "SamplingController.h"
+#include "Test.h"
+
+#include <iterator>
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+const auto FrameTime = std::chrono::milliseconds (10);
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<std::string> GetCounterNames (const std::size_t count)
+{
+	std::vector<std::string> result;
+	result.push_back ("GPUTime");
+	result.push_back ("FetchSize");
+
+	for (std::size_t i = 2; i < count; ++i) {
+		result.push_back ("Counter" + std::to_string (i));
+	}
+
+	result.resize (count);
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t GetSize (const Amd::CounterSet& counters)
+{
+	return static_cast<std::size_t> (std::distance (counters.begin (), counters.end ()));
+}
+
+/**
+Simulated application: every frame takes FrameTime, plus costPerPass for every
+pass of a profiled frame. Profiled sessions are read back one frame late.
+*/
+class Application
+{
+public:
+	Application (Amd::Context& context, Amd::SamplingController& controller)
+	: context_ (context)
+	, controller_ (controller)
+	, now_ (std::chrono::hours (1))
+	, costPerPass_ (std::chrono::microseconds (500))
+	, expectedCount_ (0)
+	, profiledFrames_ (0)
+	, changes_ (0)
+	, failures_ (0)
+	{
+	}
+
+	void Run (const int frames)
+	{
+		for (int i = 0; i < frames; ++i) {
+			lastPlan_ = controller_.BeginFrame (now_);
+
+			if (session_.IsActive () == false && expectedCount_ > 0) {
+				// Late readback, which must use the counters of the session
+				const auto result = session_.GetSampleResult (0, true);
+
+				if (result.size () != expectedCount_) {
+					++failures_;
+				}
+
+				expectedCount_ = 0;
+			}
+
+			if (lastPlan_.changePending) {
+				NIV_CHECK (!lastPlan_.profile);
+				NIV_CHECK (controller_.ApplyPendingStep ());
+				NIV_CHECK (!controller_.ApplyPendingStep ());
+				++changes_;
+			}
+
+			now_ += FrameTime;
+
+			if (lastPlan_.profile) {
+				Profile ();
+				now_ += costPerPass_ * lastPlan_.passCount;
+				++profiledFrames_;
+			}
+		}
+	}
+
+	void Profile ()
+	{
+		session_ = context_.BeginSession ();
+
+		for (int pass = 0; pass < lastPlan_.passCount; ++pass) {
+			auto p = session_.BeginPass ();
+			p.BeginSample (0).End ();
+			p.End ();
+		}
+
+		session_.End ();
+		expectedCount_ = GetSize (*lastPlan_.counters);
+	}
+
+	Amd::Context&				context_;
+	Amd::SamplingController&	controller_;
+	Clock::time_point			now_;
+	Clock::duration				costPerPass_;
+
+	Amd::Session				session_;
+	std::size_t					expectedCount_;
+
+	Amd::SamplingPlan			lastPlan_;
+	int							profiledFrames_;
+	int							changes_;
+	int							failures_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void TestStepSelection (Amd::Context& context)
+{
+	Amd::SamplingConfig config;
+	config.maxInterval = 100;
+
+	Amd::SamplingController controller (context.GetAvailableCounters (),
+		GetCounterNames (200), config);
+
+	Application application (context, controller);
+
+	// Starts with the smallest set
+	application.Run (1);
+	NIV_CHECK (GetSize (*application.lastPlan_.counters) == 1);
+	NIV_CHECK (!application.lastPlan_.profile);
+
+	// 0.5 ms per pass at 10 ms per frame and 1% budget: one profiled frame
+	// every 5 frames per pass fits, so all 200 counters in 4 passes fit into
+	// half of maxInterval
+	application.Run (3000);
+	NIV_CHECK (application.failures_ == 0);
+	NIV_CHECK (application.changes_ > 0);
+	NIV_CHECK (GetSize (*application.lastPlan_.counters) == 200);
+	NIV_CHECK (application.lastPlan_.passCount == 4);
+	NIV_CHECK (application.lastPlan_.interval >= 19 && application.lastPlan_.interval <= 21);
+	NIV_CHECK (controller.GetOverhead () > 0.008 && controller.GetOverhead () < 0.012);
+
+	// Under load, profiling gets 10 times more expensive: 4 passes would
+	// need an interval of 200, so the controller steps down to 2 passes
+	application.costPerPass_ = std::chrono::milliseconds (5);
+	const int changes = application.changes_;
+	application.Run (5000);
+	NIV_CHECK (application.failures_ == 0);
+	NIV_CHECK (application.changes_ > changes);
+	NIV_CHECK (application.lastPlan_.passCount == 2);
+	NIV_CHECK (application.lastPlan_.interval <= config.maxInterval);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestIntervalLimit (Amd::Context& context)
+{
+	Amd::SamplingConfig config;
+	config.maxInterval = 50;
+
+	Amd::SamplingController controller (context.GetAvailableCounters (),
+		GetCounterNames (1), config);
+
+	Application application (context, controller);
+	application.Run (200);
+
+	// One profiled frame hitches for 10 seconds
+	application.costPerPass_ = std::chrono::seconds (10);
+
+	const int profiledFrames = application.profiledFrames_;
+	while (application.profiledFrames_ == profiledFrames) {
+		application.Run (1);
+	}
+
+	application.costPerPass_ = std::chrono::microseconds (500);
+	application.Run (1);
+
+	// Even the smallest set is over budget, but profiling continues
+	NIV_CHECK (application.lastPlan_.interval == config.maxInterval);
+	NIV_CHECK (controller.GetOverhead () > config.budget);
+
+	application.Run (config.maxInterval);
+	NIV_CHECK (application.profiledFrames_ > profiledFrames + 1);
+	NIV_CHECK (application.failures_ == 0);
+}
+}
+
+int main ()
+{
+	try {
+		Amd::PerformanceLibrary library (Amd::ProfileApi::OpenCL);
+
+		// The stand-in library ignores the context, but Context only closes
+		// non-null ones
+		static int dummyContext;
+		auto context = library.OpenContext (&dummyContext);
+
+		TestStepSelection (context);
+		TestIntervalLimit (context);
+	} catch (const std::exception& e) {
+		::fprintf (stderr, "%s\n", e.what ());
+		return 1;
+	}
+
+	return NIV_TEST_RESULT ();
+}
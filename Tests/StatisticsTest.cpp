@@ -0,0 +1,67 @@
+#include "Statistics.h"
+#include "Test.h"
+
+#include <cmath>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+bool IsClose (const double a, const double b, const double tolerance)
+{
+	return std::abs (a - b) <= tolerance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestMean ()
+{
+	NIV_CHECK (Amd::Mean (std::vector<double> ()) == 0);
+	NIV_CHECK (Amd::Mean (std::vector<double> { 1, 2, 3, 6 }) == 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestMannWhitney ()
+{
+	const std::vector<double> a { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	const std::vector<double> b { 11, 12, 13, 14, 15, 16, 17, 18, 19, 20 };
+
+	// U = 0, mean 50, variance 175: z = 49.5 / sqrt (175)
+	NIV_CHECK (IsClose (Amd::MannWhitneyP (a, b), 1.8267e-4, 1e-7));
+	NIV_CHECK (Amd::MannWhitneyP (a, b) == Amd::MannWhitneyP (b, a));
+
+	// Identical distributions
+	NIV_CHECK (Amd::MannWhitneyP (a, a) == 1);
+	NIV_CHECK (Amd::MannWhitneyP (std::vector<double> (5, 3), std::vector<double> (7, 3)) == 1);
+
+	// Ties get the average rank: ranks of c are 1.5, 3.5, 5.5 and 5.5, so
+	// U = 6, mean 8, tie corrected variance 4/3 * (9 - 18/56)
+	const std::vector<double> c { 1, 2, 3, 3 };
+	const std::vector<double> d { 1, 2, 4, 5 };
+	NIV_CHECK (IsClose (Amd::MannWhitneyP (c, d), std::erfc (1.5 / std::sqrt (4.0 / 3 * (9 - 18.0 / 56)) / std::sqrt (2.0)), 1e-12));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestBootstrap ()
+{
+	const std::vector<double> a { 10, 11, 9, 10, 12, 8, 10, 11, 9, 10 };
+	const std::vector<double> b { 20, 21, 19, 20, 22, 18, 20, 21, 19, 20 };
+
+	NIV_CHECK (Amd::BootstrapP (a, b, 1000, 1) == 0);
+	NIV_CHECK (Amd::BootstrapP (a, a, 1000, 1) > 0.5);
+
+	// Deterministic for a seed
+	std::vector<double> c = a;
+	c [0] = 12;
+	NIV_CHECK (Amd::BootstrapP (a, c, 500, 42) == Amd::BootstrapP (a, c, 500, 42));
+
+	const double p = Amd::BootstrapP (a, c, 2000, 7);
+	NIV_CHECK (p > 0 && p <= 1);
+}
+}
+
+int main ()
+{
+	TestMean ();
+	TestMannWhitney ();
+	TestBootstrap ();
+
+	return NIV_TEST_RESULT ();
+}
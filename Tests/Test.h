@@ -0,0 +1,37 @@
+#ifndef NIV_AMD_PERF_LIB_TESTS_TEST_H_E41B7C93_2D6F_4A58_9C03_7F8A1B5D2E64
+#define NIV_AMD_PERF_LIB_TESTS_TEST_H_E41B7C93_2D6F_4A58_9C03_7F8A1B5D2E64
+
+#include <stdio.h>
+
+/**
+Minimal checks for the tests, each test is a separate executable registered
+with CTest. A failed check is reported and the test continues; main returns
+NIV_TEST_RESULT () to fail the test if any check failed.
+*/
+namespace Amd {
+namespace Test {
+inline int& GetFailureCount ()
+{
+	static int count = 0;
+	return count;
+}
+
+inline void Fail (const char* file, const int line, const char* expression)
+{
+	::fprintf (stderr, "%s(%d): check failed: %s\n", file, line, expression);
+	++GetFailureCount ();
+}
+}
+}
+
+#define NIV_CHECK(expr) do { if (!(expr)) ::Amd::Test::Fail (__FILE__, __LINE__, #expr); } while (0)
+
+#define NIV_CHECK_THROWS(expr) do { \
+	bool thrown_ = false; \
+	try { expr; } catch (...) { thrown_ = true; } \
+	if (!thrown_) ::Amd::Test::Fail (__FILE__, __LINE__, "throws: " #expr); \
+	} while (0)
+
+#define NIV_TEST_RESULT() (::Amd::Test::GetFailureCount () == 0 ? 0 : 1)
+
+#endif
@@ -0,0 +1,140 @@
+#include "TimeSeries.h"
+#include "Test.h"
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+// Start of a minute, so all intervals start at base + n * interval
+const Clock::time_point base (std::chrono::hours (1));
+
+////////////////////////////////////////////////////////////////////////////////
+Clock::time_point At (const double seconds)
+{
+	return base + std::chrono::duration_cast<Clock::duration> (
+		std::chrono::duration<double> (seconds));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Amd::SessionResult MakeResult (const double value)
+{
+	Amd::ResultEntry entry;
+	entry.dataType = Amd::DataType::float64;
+	entry.f64 = value;
+
+	Amd::SessionResult result;
+	result ["GPUTime"] = entry;
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Amd::TimeSeriesConfig MakeConfig ()
+{
+	Amd::TimeSeriesConfig config;
+	config.frames = 8;
+	config.seconds = 10;
+	config.tenSeconds = 6;
+	config.minutes = 5;
+	return config;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<Amd::TimeSeriesAggregate> QueryAll (const Amd::TimeSeriesStore& store,
+	const Amd::Resolution::Enum resolution)
+{
+	return store.Query ("GPUTime", resolution, base, At (1e6));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestAggregation ()
+{
+	Amd::TimeSeriesStore store (std::vector<std::string> (1, "GPUTime"), MakeConfig ());
+
+	store.Add (At (0.1), MakeResult (1));
+	store.Add (At (0.5), MakeResult (3));
+	store.Add (At (1.5), MakeResult (5));
+
+	// Out of order, goes into the current interval
+	store.Add (At (0.9), MakeResult (7));
+
+	const auto seconds = QueryAll (store, Amd::Resolution::Second);
+	NIV_CHECK (seconds.size () == 2);
+	NIV_CHECK (seconds [0].start == At (0));
+	NIV_CHECK (seconds [0].minimum == 1 && seconds [0].maximum == 3);
+	NIV_CHECK (seconds [0].mean == 2 && seconds [0].count == 2);
+	NIV_CHECK (seconds [1].start == At (1));
+	NIV_CHECK (seconds [1].count == 2 && seconds [1].maximum == 7);
+
+	const auto minutes = QueryAll (store, Amd::Resolution::Minute);
+	NIV_CHECK (minutes.size () == 1);
+	NIV_CHECK (minutes [0].count == 4 && minutes [0].mean == 4);
+
+	// Only intervals overlapping the range
+	NIV_CHECK (store.Query ("GPUTime", Amd::Resolution::Second, At (1.2), At (5)).size () == 1);
+
+	NIV_CHECK (store.Query ("Unknown", Amd::Resolution::Second, base, At (10)).empty ());
+	NIV_CHECK_THROWS (store.Query ("GPUTime", static_cast<Amd::Resolution::Enum> (3), base, At (10)));
+	NIV_CHECK_THROWS (store.Query ("GPUTime", static_cast<Amd::Resolution::Enum> (-1), base, At (10)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestRollover ()
+{
+	Amd::TimeSeriesStore store (std::vector<std::string> (1, "GPUTime"), MakeConfig ());
+
+	for (int i = 0; i < 15; ++i) {
+		store.Add (At (i + 0.5), MakeResult (i));
+	}
+
+	// Last 10 seconds, last 8 frames
+	auto seconds = QueryAll (store, Amd::Resolution::Second);
+	NIV_CHECK (seconds.size () == 10);
+	NIV_CHECK (seconds.front ().start == At (5));
+	NIV_CHECK (seconds.back ().start == At (14));
+
+	const auto frames = store.QueryFrames ("GPUTime", base, At (1e6));
+	NIV_CHECK (frames.size () == 8);
+	NIV_CHECK (frames.front ().value == 7 && frames.back ().value == 14);
+
+	// After a pause shorter than the window, the intervals in between are
+	// empty and the ones before it are dropped
+	store.Add (At (18.5), MakeResult (18));
+
+	seconds = QueryAll (store, Amd::Resolution::Second);
+	NIV_CHECK (seconds.size () == 7);
+	NIV_CHECK (seconds.front ().start == At (9));
+	NIV_CHECK (seconds.back ().start == At (18));
+
+	// After a pause longer than the window, only the new interval is left
+	store.Add (At (100.5), MakeResult (100));
+
+	seconds = QueryAll (store, Amd::Resolution::Second);
+	NIV_CHECK (seconds.size () == 1);
+	NIV_CHECK (seconds.front ().start == At (100));
+	NIV_CHECK (seconds.front ().mean == 100);
+
+	// 60 seconds at 10 second resolution
+	const auto tenSeconds = QueryAll (store, Amd::Resolution::TenSeconds);
+	NIV_CHECK (tenSeconds.size () == 1);
+	NIV_CHECK (tenSeconds.front ().start == At (100));
+
+	// Both minutes are within the last 5
+	const auto minutes = QueryAll (store, Amd::Resolution::Minute);
+	NIV_CHECK (minutes.size () == 2);
+	NIV_CHECK (minutes [0].count == 16 && minutes [1].count == 1);
+
+	// Frames are not affected by time
+	NIV_CHECK (store.QueryFrames ("GPUTime", base, At (1e6)).size () == 8);
+
+	// A day later, everything but the newest minute has expired
+	store.Add (At (86400.5), MakeResult (1));
+	NIV_CHECK (QueryAll (store, Amd::Resolution::Minute).size () == 1);
+}
+}
+
+int main ()
+{
+	TestAggregation ();
+	TestRollover ();
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,427 @@
+#include "TraceExporter.h"
+#include "Test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+Amd::SessionResult MakeResult (const double value)
+{
+	Amd::ResultEntry entry;
+	entry.dataType = Amd::DataType::float64;
+	entry.f64 = value;
+
+	Amd::SessionResult result;
+	result ["GPUTime"] = entry;
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RecordSession (Amd::TraceExporter& exporter, const std::uint32_t sessionId,
+	const std::uint32_t sampleId)
+{
+	exporter.OnBeginSession (sessionId);
+	exporter.OnBeginPass ();
+	exporter.OnBeginSample (sampleId);
+	exporter.OnEndSample (sampleId);
+	exporter.OnEndPass ();
+	exporter.OnEndSession (sessionId);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string ReadFile (const std::string& filename)
+{
+	std::ifstream file (filename, std::ios::binary);
+	std::stringstream result;
+	result << file.rdbuf ();
+	return result.str ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<double> GetTimestamps (const std::string& json)
+{
+	std::vector<double> result;
+
+	for (auto pos = json.find ("\"ts\":"); pos != std::string::npos;
+		pos = json.find ("\"ts\":", pos + 1)) {
+		result.push_back (std::stod (json.substr (pos + 5)));
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t Count (const std::string& text, const std::string& pattern)
+{
+	std::size_t result = 0;
+
+	for (auto pos = text.find (pattern); pos != std::string::npos;
+		pos = text.find (pattern, pos + 1)) {
+		++result;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint64_t GetMonotonicNanoseconds ()
+{
+	return static_cast<std::uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (
+		std::chrono::steady_clock::now ().time_since_epoch ()).count ());
+}
+
+/**
+Minimal protobuf reader for the fields written by the Perfetto writer.
+*/
+class ProtoReader
+{
+public:
+	explicit ProtoReader (const std::string& data)
+	: data_ (data)
+	, offset_ (0)
+	, failed_ (false)
+	{
+	}
+
+	/**
+	Read the next field; value is set for varint and fixed64 fields, bytes for
+	length delimited ones.
+	*/
+	bool Next (std::uint32_t& field, std::uint64_t& value, std::string& bytes)
+	{
+		if (failed_ || offset_ >= data_.size ()) {
+			return false;
+		}
+
+		const auto tag = ReadVarint ();
+		field = static_cast<std::uint32_t> (tag >> 3);
+
+		switch (tag & 7) {
+		case 0:
+			value = ReadVarint ();
+			break;
+		case 1:
+			if (offset_ + 8 > data_.size ()) {
+				failed_ = true;
+				return false;
+			}
+			::memcpy (&value, data_.data () + offset_, 8);
+			offset_ += 8;
+			break;
+		case 2:
+		{
+			const auto size = static_cast<std::size_t> (ReadVarint ());
+			if (offset_ + size > data_.size ()) {
+				failed_ = true;
+				return false;
+			}
+			bytes = data_.substr (offset_, size);
+			offset_ += size;
+			break;
+		}
+		default:
+			failed_ = true;
+			return false;
+		}
+
+		return !failed_;
+	}
+
+	bool IsValid () const
+	{
+		return !failed_ && offset_ == data_.size ();
+	}
+
+private:
+	std::uint64_t ReadVarint ()
+	{
+		std::uint64_t result = 0;
+
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (offset_ >= data_.size ()) {
+				break;
+			}
+
+			const auto byte = static_cast<unsigned char> (data_ [offset_++]);
+			result |= static_cast<std::uint64_t> (byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0) {
+				return result;
+			}
+		}
+
+		failed_ = true;
+		return 0;
+	}
+
+	const std::string&	data_;
+	std::size_t			offset_;
+	bool				failed_;
+};
+
+struct Packet
+{
+	Packet ()
+	: timestamp (0)
+	, clockId (0)
+	, sequenceId (0)
+	, sequenceFlags (0)
+	, hasTrackEvent (false)
+	, type (0)
+	, trackUuid (0)
+	, value (0)
+	, hasDescriptor (false)
+	, descriptorUuid (0)
+	, isCounterTrack (false)
+	{
+	}
+
+	std::uint64_t	timestamp;
+	std::uint64_t	clockId;
+	std::uint64_t	sequenceId;
+	std::uint64_t	sequenceFlags;
+
+	bool			hasTrackEvent;
+	std::uint64_t	type;
+	std::uint64_t	trackUuid;
+	std::string		name;
+	double			value;
+
+	bool			hasDescriptor;
+	std::uint64_t	descriptorUuid;
+	std::string		descriptorName;
+	bool			isCounterTrack;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<Packet> ReadPackets (const std::string& trace)
+{
+	std::vector<Packet> result;
+	ProtoReader reader (trace);
+	std::uint32_t field;
+	std::uint64_t value;
+	std::string bytes;
+
+	while (reader.Next (field, value, bytes)) {
+		NIV_CHECK (field == 1);
+
+		Packet packet;
+		const std::string packetBytes = bytes;
+		ProtoReader packetReader (packetBytes);
+
+		while (packetReader.Next (field, value, bytes)) {
+			switch (field) {
+			case 8:		packet.timestamp = value; break;
+			case 10:	packet.sequenceId = value; break;
+			case 13:	packet.sequenceFlags = value; break;
+			case 58:	packet.clockId = value; break;
+			case 11:
+			{
+				packet.hasTrackEvent = true;
+				const std::string eventBytes = bytes;
+				ProtoReader eventReader (eventBytes);
+
+				while (eventReader.Next (field, value, bytes)) {
+					switch (field) {
+					case 9:		packet.type = value; break;
+					case 11:	packet.trackUuid = value; break;
+					case 23:	packet.name = bytes; break;
+					case 44:	::memcpy (&packet.value, &value, sizeof (double)); break;
+					}
+				}
+
+				NIV_CHECK (eventReader.IsValid ());
+				break;
+			}
+			case 60:
+			{
+				packet.hasDescriptor = true;
+				const std::string descriptorBytes = bytes;
+				ProtoReader descriptorReader (descriptorBytes);
+
+				while (descriptorReader.Next (field, value, bytes)) {
+					switch (field) {
+					case 1:	packet.descriptorUuid = value; break;
+					case 2:	packet.descriptorName = bytes; break;
+					case 8:	packet.isCounterTrack = true; break;
+					}
+				}
+
+				NIV_CHECK (descriptorReader.IsValid ());
+				break;
+			}
+			}
+		}
+
+		NIV_CHECK (packetReader.IsValid ());
+		result.push_back (packet);
+	}
+
+	NIV_CHECK (reader.IsValid ());
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestCountersInTimestampOrder ()
+{
+	const auto start = GetMonotonicNanoseconds ();
+
+	{
+		Amd::TraceExporter exporter ("TraceExporterTest.json", Amd::TraceFormat::ChromeJson);
+
+		// Results are read back late and out of order
+		RecordSession (exporter, 1, 3);
+		RecordSession (exporter, 2, 4);
+		exporter.OnSampleResult (2, 4, MakeResult (2));
+		exporter.OnSampleResult (1, 3, MakeResult (1));
+
+		// Already exported
+		exporter.OnSampleResult (1, 3, MakeResult (1));
+	}
+
+	const auto json = ReadFile ("TraceExporterTest.json");
+	const auto timestamps = GetTimestamps (json);
+
+	NIV_CHECK (Count (json, "\"ph\":\"C\"") == 2);
+	NIV_CHECK (timestamps.size () == 14);
+	NIV_CHECK (std::is_sorted (timestamps.begin (), timestamps.end ()));
+
+	// Absolute steady_clock time in microseconds, not relative to the exporter
+	NIV_CHECK (timestamps.front () >= static_cast<double> (start / 1000));
+	NIV_CHECK (timestamps.back () <= static_cast<double> (GetMonotonicNanoseconds () / 1000 + 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestPerfetto ()
+{
+	const auto start = GetMonotonicNanoseconds ();
+
+	{
+		Amd::TraceExporter exporter ("TraceExporterTest.pftrace", Amd::TraceFormat::Perfetto);
+		exporter.SetSampleName (3, "shadow");
+
+		RecordSession (exporter, 1, 3);
+		RecordSession (exporter, 2, 4);
+
+		Amd::SessionResult result = MakeResult (2.5);
+		result ["FetchSize"] = result ["GPUTime"];
+		result ["FetchSize"].f64 = 7;
+		exporter.OnSampleResult (2, 4, result);
+		exporter.OnSampleResult (1, 3, MakeResult (1.5));
+	}
+
+	const auto end = GetMonotonicNanoseconds ();
+	const auto packets = ReadPackets (ReadFile ("TraceExporterTest.pftrace"));
+
+	// Header with the track for the scopes
+	NIV_CHECK (packets.size () > 0);
+	NIV_CHECK (packets [0].hasDescriptor && !packets [0].isCounterTrack);
+	NIV_CHECK (packets [0].sequenceFlags == 1);
+	const auto scopeTrack = packets [0].descriptorUuid;
+
+	std::map<std::uint64_t, std::string> counterTracks;
+	std::map<std::string, double> counterValues;
+	std::vector<std::uint64_t> timestamps;
+	std::vector<std::string> slices;
+	int depth = 0;
+	int maxDepth = 0;
+
+	for (std::size_t i = 0; i < packets.size (); ++i) {
+		const auto& packet = packets [i];
+		NIV_CHECK (packet.sequenceId == 1);
+		NIV_CHECK (i == 0 || packet.sequenceFlags == 0);
+
+		if (packet.hasDescriptor) {
+			if (packet.isCounterTrack) {
+				NIV_CHECK (packet.descriptorUuid != scopeTrack);
+				NIV_CHECK (counterTracks.count (packet.descriptorUuid) == 0);
+				counterTracks [packet.descriptorUuid] = packet.descriptorName;
+			}
+			continue;
+		}
+
+		NIV_CHECK (packet.hasTrackEvent);
+		// CLOCK_MONOTONIC
+		NIV_CHECK (packet.clockId == 3);
+		NIV_CHECK (packet.timestamp >= start && packet.timestamp <= end);
+		timestamps.push_back (packet.timestamp);
+
+		switch (packet.type) {
+		case 1:
+			NIV_CHECK (packet.trackUuid == scopeTrack);
+			slices.push_back (packet.name);
+			maxDepth = std::max (maxDepth, ++depth);
+			break;
+		case 2:
+			NIV_CHECK (packet.trackUuid == scopeTrack);
+			NIV_CHECK (depth-- > 0);
+			break;
+		case 4:
+			// Descriptor is written before the first value
+			NIV_CHECK (counterTracks.count (packet.trackUuid) == 1);
+			counterValues [counterTracks [packet.trackUuid]] = packet.value;
+			break;
+		default:
+			NIV_CHECK (false);
+		}
+	}
+
+	NIV_CHECK (depth == 0);
+	NIV_CHECK (maxDepth == 3);
+	NIV_CHECK (timestamps.size () == 15);
+	NIV_CHECK (std::is_sorted (timestamps.begin (), timestamps.end ()));
+
+	NIV_CHECK (slices.size () == 6);
+	NIV_CHECK (slices [0] == "Session 1");
+	NIV_CHECK (slices [1] == "Pass 0");
+	NIV_CHECK (slices [2] == "shadow");
+	NIV_CHECK (slices [5] == "Sample 4");
+
+	NIV_CHECK (counterTracks.size () == 3);
+	NIV_CHECK (counterValues.size () == 3);
+	NIV_CHECK (counterValues ["shadow/GPUTime"] == 1.5);
+	NIV_CHECK (counterValues ["Sample 4/GPUTime"] == 2.5);
+	NIV_CHECK (counterValues ["Sample 4/FetchSize"] == 7);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TestUnreadSessionsAreWritten ()
+{
+	{
+		Amd::TraceExporter exporter ("TraceExporterTest.json", Amd::TraceFormat::ChromeJson);
+
+		// Never read back, only the last ones may be held
+		for (std::uint32_t session = 1; session <= 100; ++session) {
+			RecordSession (exporter, session, 0);
+		}
+
+		// Session 1 has been written already, so its result is dropped;
+		// session 100 is still held and gets its counters
+		exporter.OnSampleResult (1, 0, MakeResult (1));
+		exporter.OnSampleResult (100, 0, MakeResult (1));
+		exporter.Flush ();
+
+		NIV_CHECK (Count (ReadFile ("TraceExporterTest.json"), "\"ph\":\"B\"") == 300);
+	}
+
+	const auto json = ReadFile ("TraceExporterTest.json");
+	NIV_CHECK (Count (json, "\"ph\":\"C\"") == 1);
+	NIV_CHECK (Count (json, "\"ph\":\"E\"") == 300);
+}
+}
+
+int main ()
+{
+	TestCountersInTimestampOrder ();
+	TestUnreadSessionsAreWritten ();
+	TestPerfetto ();
+
+	return NIV_TEST_RESULT ();
+}
@@ -0,0 +1,296 @@
+#include "TimeSeries.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+namespace Amd {
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+struct Bucket
+{
+	double			minimum;
+	double			maximum;
+	double			sum;
+	std::uint64_t	count;
+};
+
+/**
+Ring of intervals, with one bucket per series and interval. head is the
+newest interval, which is still being filled.
+*/
+struct Tier
+{
+	Tier (const Clock::duration interval, const std::size_t capacity,
+		const std::size_t seriesCount)
+	: interval (interval)
+	, capacity (std::max<std::size_t> (1, capacity))
+	, starts (this->capacity)
+	, buckets (this->capacity * seriesCount)
+	, head (0)
+	, size (0)
+	{
+	}
+
+	void Advance (const Clock::time_point time, const std::size_t seriesCount)
+	{
+		const auto sinceEpoch = time.time_since_epoch ();
+		const Clock::time_point start (sinceEpoch - sinceEpoch % interval);
+
+		// Values arriving out of order go into the current interval
+		if (size > 0 && start <= starts [head]) {
+			return;
+		}
+
+		// One slot per elapsed interval, so the ring always covers the last
+		// capacity intervals; intervals without values are left empty
+		std::size_t steps = 1;
+
+		if (size > 0) {
+			const Clock::duration::rep elapsed = (start - starts [head]) / interval;
+			steps = static_cast<std::size_t> (std::min (elapsed,
+				static_cast<Clock::duration::rep> (capacity)));
+		}
+
+		for (std::size_t i = steps; i > 0; --i) {
+			if (size > 0) {
+				head = (head + 1) % capacity;
+			}
+
+			size = std::min (size + 1, capacity);
+			starts [head] = start - static_cast<Clock::duration::rep> (i - 1) * interval;
+
+			for (std::size_t s = 0; s < seriesCount; ++s) {
+				Bucket& bucket = buckets [s * capacity + head];
+				bucket.minimum = std::numeric_limits<double>::infinity ();
+				bucket.maximum = -std::numeric_limits<double>::infinity ();
+				bucket.sum = 0;
+				bucket.count = 0;
+			}
+		}
+	}
+
+	void Update (const std::size_t series, const double value)
+	{
+		Bucket& bucket = buckets [series * capacity + head];
+		bucket.minimum = std::min (bucket.minimum, value);
+		bucket.maximum = std::max (bucket.maximum, value);
+		bucket.sum += value;
+		++bucket.count;
+	}
+
+	Clock::duration					interval;
+	std::size_t						capacity;
+	std::vector<Clock::time_point>	starts;
+	std::vector<Bucket>				buckets;	///< capacity buckets per series
+	std::size_t						head;
+	std::size_t						size;
+};
+}
+
+struct TimeSeriesStore::Impl
+{
+	Impl (const std::vector<std::string>& counters, const TimeSeriesConfig& config)
+	: frameCapacity_ (std::max<std::size_t> (1, config.frames))
+	, frameTimes_ (frameCapacity_)
+	, frameHead_ (0)
+	, frameCount_ (0)
+	{
+		for (const auto& counter : counters) {
+			if (series_.find (counter) == series_.end ()) {
+				series_.emplace (counter, series_.size ());
+			}
+		}
+
+		frameValues_.resize (frameCapacity_ * series_.size ());
+
+		tiers_.emplace_back (std::chrono::seconds (1), config.seconds, series_.size ());
+		tiers_.emplace_back (std::chrono::seconds (10), config.tenSeconds, series_.size ());
+		tiers_.emplace_back (std::chrono::minutes (1), config.minutes, series_.size ());
+	}
+
+	void Add (const Clock::time_point time, const SessionResult& result)
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+
+		const std::size_t seriesCount = series_.size ();
+		const std::size_t slot = frameHead_;
+
+		frameTimes_ [slot] = time;
+		for (std::size_t s = 0; s < seriesCount; ++s) {
+			frameValues_ [s * frameCapacity_ + slot] = std::numeric_limits<double>::quiet_NaN ();
+		}
+
+		frameHead_ = (frameHead_ + 1) % frameCapacity_;
+		frameCount_ = std::min (frameCount_ + 1, frameCapacity_);
+
+		for (auto& tier : tiers_) {
+			tier.Advance (time, seriesCount);
+		}
+
+		for (const auto& kv : result) {
+			auto it = series_.find (kv.first);
+
+			if (it == series_.end ()) {
+				continue;
+			}
+
+			const double value = ToDouble (kv.second);
+			frameValues_ [it->second * frameCapacity_ + slot] = value;
+
+			for (auto& tier : tiers_) {
+				tier.Update (it->second, value);
+			}
+		}
+	}
+
+	std::vector<TimeSeriesPoint> QueryFrames (const std::string& counter,
+		const Clock::time_point from, const Clock::time_point to) const
+	{
+		std::vector<TimeSeriesPoint> result;
+
+		std::lock_guard<std::mutex> lock (mutex_);
+
+		auto it = series_.find (counter);
+		if (it == series_.end ()) {
+			return result;
+		}
+
+		const std::size_t oldest = (frameHead_ + frameCapacity_ - frameCount_) % frameCapacity_;
+
+		for (std::size_t i = 0; i < frameCount_; ++i) {
+			const std::size_t slot = (oldest + i) % frameCapacity_;
+			const double value = frameValues_ [it->second * frameCapacity_ + slot];
+
+			if (frameTimes_ [slot] < from || frameTimes_ [slot] > to || value != value) {
+				continue;
+			}
+
+			TimeSeriesPoint point;
+			point.time = frameTimes_ [slot];
+			point.value = value;
+			result.push_back (point);
+		}
+
+		return result;
+	}
+
+	std::vector<TimeSeriesAggregate> Query (const std::string& counter,
+		const Resolution::Enum resolution, const Clock::time_point from,
+		const Clock::time_point to) const
+	{
+		// Negative values wrap around
+		if (static_cast<std::size_t> (resolution) >= tiers_.size ()) {
+			throw std::runtime_error ("Invalid time series resolution.");
+		}
+
+		std::vector<TimeSeriesAggregate> result;
+
+		std::lock_guard<std::mutex> lock (mutex_);
+
+		auto it = series_.find (counter);
+		if (it == series_.end ()) {
+			return result;
+		}
+
+		const Tier& tier = tiers_ [resolution];
+		const std::size_t oldest = (tier.head + 1 + tier.capacity - tier.size) % tier.capacity;
+
+		for (std::size_t i = 0; i < tier.size; ++i) {
+			const std::size_t slot = (oldest + i) % tier.capacity;
+			const Bucket& bucket = tier.buckets [it->second * tier.capacity + slot];
+			const auto start = tier.starts [slot];
+
+			if (bucket.count == 0 || start + tier.interval <= from || start > to) {
+				continue;
+			}
+
+			TimeSeriesAggregate aggregate;
+			aggregate.start = start;
+			aggregate.minimum = bucket.minimum;
+			aggregate.maximum = bucket.maximum;
+			aggregate.mean = bucket.sum / static_cast<double> (bucket.count);
+			aggregate.count = bucket.count;
+			result.push_back (aggregate);
+		}
+
+		return result;
+	}
+
+	std::size_t GetMemorySize () const
+	{
+		std::size_t result = frameTimes_.capacity () * sizeof (Clock::time_point)
+			+ frameValues_.capacity () * sizeof (double);
+
+		for (const auto& tier : tiers_) {
+			result += tier.starts.capacity () * sizeof (Clock::time_point)
+				+ tier.buckets.capacity () * sizeof (Bucket);
+		}
+
+		return result;
+	}
+
+private:
+	mutable std::mutex					mutex_;
+	std::map<std::string, std::size_t>	series_;
+
+	std::size_t							frameCapacity_;
+	std::vector<Clock::time_point>		frameTimes_;
+	std::vector<double>					frameValues_;	///< frameCapacity_ values per series, NaN if missing
+	std::size_t							frameHead_;		///< Next slot to write
+	std::size_t							frameCount_;
+
+	std::vector<Tier>					tiers_;			///< Indexed by Resolution
+};
+
+////////////////////////////////////////////////////////////////////////////////
+TimeSeriesStore::TimeSeriesStore (const std::vector<std::string>& counters,
+	const TimeSeriesConfig& config)
+: impl_ (new Impl (counters, config))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TimeSeriesStore::~TimeSeriesStore ()
+{
+	delete impl_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TimeSeriesStore::Add (const SessionResult& result)
+{
+	impl_->Add (Clock::now (), result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TimeSeriesStore::Add (const std::chrono::steady_clock::time_point time,
+	const SessionResult& result)
+{
+	impl_->Add (time, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<TimeSeriesPoint> TimeSeriesStore::QueryFrames (const std::string& counter,
+	const std::chrono::steady_clock::time_point from,
+	const std::chrono::steady_clock::time_point to) const
+{
+	return impl_->QueryFrames (counter, from, to);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<TimeSeriesAggregate> TimeSeriesStore::Query (const std::string& counter,
+	const Resolution::Enum resolution,
+	const std::chrono::steady_clock::time_point from,
+	const std::chrono::steady_clock::time_point to) const
+{
+	return impl_->Query (counter, resolution, from, to);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t TimeSeriesStore::GetMemorySize () const
+{
+	return impl_->GetMemorySize ();
+}
+}
@@ -0,0 +1,115 @@
+#ifndef NIV_AMD_PERF_LIB_TIMESERIES_H_A83C1F62_9E4B_4D07_B5C8_3F1E6D2A9B74
+#define NIV_AMD_PERF_LIB_TIMESERIES_H_A83C1F62_9E4B_4D07_B5C8_3F1E6D2A9B74
+
+#include "PerfLib.h"
+
+#include <chrono>
+
+namespace Amd {
+struct Resolution
+{
+	enum Enum
+	{
+		Second,
+		TenSeconds,
+		Minute
+	};
+};
+
+struct TimeSeriesPoint
+{
+	std::chrono::steady_clock::time_point	time;
+	double									value;
+};
+
+struct TimeSeriesAggregate
+{
+	std::chrono::steady_clock::time_point	start;	///< Start of the interval
+	double									minimum;
+	double									maximum;
+	double									mean;
+	std::uint64_t							count;
+};
+
+/**
+Number of frames kept at full resolution, and number of intervals kept per
+resolution. The defaults keep 1024 frames, 10 minutes of seconds, 2 hours of
+10 seconds and a day of minutes.
+*/
+struct TimeSeriesConfig
+{
+	TimeSeriesConfig ()
+	: frames (1024)
+	, seconds (600)
+	, tenSeconds (720)
+	, minutes (1440)
+	{
+	}
+
+	std::size_t	frames;
+	std::size_t	seconds;
+	std::size_t	tenSeconds;
+	std::size_t	minutes;
+};
+
+/**
+Keeps the history of a fixed set of counters in bounded memory.
+
+The most recent frames are stored at full resolution; additionally, every
+value is aggregated into 1 second, 10 second and 1 minute intervals. All
+storage is ring buffers allocated in the constructor, once full, the oldest
+frames or intervals are overwritten. Intervals advance with time, not with
+the values added, so after a pause, the intervals it covers are kept empty and
+older ones are dropped. Add does not allocate.
+
+Add and the queries may be called from different threads.
+*/
+class TimeSeriesStore
+{
+public:
+	// Noncopyable
+	TimeSeriesStore (const TimeSeriesStore& other) = delete;
+	TimeSeriesStore& operator= (const TimeSeriesStore& other) = delete;
+
+	TimeSeriesStore (const std::vector<std::string>& counters,
+		const TimeSeriesConfig& config = TimeSeriesConfig ());
+	~TimeSeriesStore ();
+
+	/**
+	Add one frame. Counters in result which are not part of the store are
+	ignored.
+	*/
+	void Add (const SessionResult& result);
+	void Add (const std::chrono::steady_clock::time_point time,
+		const SessionResult& result);
+
+	/**
+	Frames at full resolution within [from, to], oldest first. Empty if the
+	counter is not part of the store.
+	*/
+	std::vector<TimeSeriesPoint> QueryFrames (const std::string& counter,
+		const std::chrono::steady_clock::time_point from,
+		const std::chrono::steady_clock::time_point to) const;
+
+	/**
+	Intervals overlapping [from, to] which contain at least one value, oldest
+	first. The last interval may still be in progress. Throws if resolution is
+	not a Resolution value.
+	*/
+	std::vector<TimeSeriesAggregate> Query (const std::string& counter,
+		const Resolution::Enum resolution,
+		const std::chrono::steady_clock::time_point from,
+		const std::chrono::steady_clock::time_point to) const;
+
+	/**
+	Size of all preallocated storage in bytes.
+	*/
+	std::size_t GetMemorySize () const;
+
+private:
+	struct Impl;
+	Impl*	impl_;
+};
+}
+
+#endif
@@ -0,0 +1,679 @@
+#include "TraceExporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <utility>
+
+namespace Amd {
+namespace {
+struct EventType
+{
+	enum Enum
+	{
+		SliceBegin,
+		SliceEnd,
+		Counter
+	};
+};
+
+struct Event
+{
+	EventType::Enum		type;
+	std::uint64_t		timestamp;	///< Nanoseconds of std::chrono::steady_clock
+	std::string			name;
+	std::vector<std::pair<std::string, double>>	values;
+};
+
+/**
+Ended sessions whose events are held back waiting for results. Once more
+sessions have ended, the oldest one is written without its missing results.
+*/
+const std::size_t MaxHeldSessions = 64;
+
+/**
+Events of one session, held back until the results of all its samples have
+been read back, so the counter events can be placed in timestamp order.
+*/
+struct SessionEvents
+{
+	std::uint32_t							id;
+	std::vector<Event>						events;
+	std::map<std::uint32_t, std::uint64_t>	sampleEnds;	///< Samples without results yet
+	bool									ended;
+};
+
+class TraceWriter
+{
+public:
+	virtual ~TraceWriter ()
+	{
+	}
+
+	virtual void WriteHeader (std::string& out) = 0;
+	virtual void WriteEvent (const Event& event, std::string& out) = 0;
+	virtual void WriteFooter (std::string& out) = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void AppendJsonString (const std::string& s, std::string& out)
+{
+	out += '"';
+	for (const char c : s) {
+		switch (c) {
+		case '"':	out += "\\\""; break;
+		case '\\':	out += "\\\\"; break;
+		case '\n':	out += "\\n"; break;
+		case '\r':	out += "\\r"; break;
+		case '\t':	out += "\\t"; break;
+		default:
+			if (static_cast<unsigned char> (c) < 0x20) {
+				char buffer [8];
+				::snprintf (buffer, sizeof (buffer), "\\u%04x", c);
+				out += buffer;
+			} else {
+				out += c;
+			}
+		}
+	}
+	out += '"';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AppendJsonNumber (const double value, std::string& out)
+{
+	char buffer [32];
+	// JSON has no representation for NaN or infinity
+	::snprintf (buffer, sizeof (buffer), "%.17g", std::isfinite (value) ? value : 0.0);
+	out += buffer;
+}
+
+class ChromeJsonWriter : public TraceWriter
+{
+public:
+	ChromeJsonWriter ()
+	: first_ (true)
+	{
+	}
+
+	void WriteHeader (std::string& out) override
+	{
+		out += "{\"traceEvents\":[\n"
+			"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPUPerfAPI\"}}";
+		first_ = false;
+	}
+
+	void WriteEvent (const Event& event, std::string& out) override
+	{
+		if (!first_) {
+			out += ",\n";
+		}
+		first_ = false;
+
+		char timestamp [32];
+		::snprintf (timestamp, sizeof (timestamp), "%.3f",
+			static_cast<double> (event.timestamp) / 1000.0);
+
+		out += "{\"name\":";
+		AppendJsonString (event.name, out);
+
+		switch (event.type) {
+		case EventType::SliceBegin:
+			out += ",\"ph\":\"B\",\"pid\":1,\"tid\":1,\"ts\":";
+			out += timestamp;
+			break;
+		case EventType::SliceEnd:
+			out += ",\"ph\":\"E\",\"pid\":1,\"tid\":1,\"ts\":";
+			out += timestamp;
+			break;
+		case EventType::Counter:
+			out += ",\"ph\":\"C\",\"pid\":1,\"ts\":";
+			out += timestamp;
+			out += ",\"args\":{";
+			for (std::size_t i = 0; i < event.values.size (); ++i) {
+				if (i > 0) {
+					out += ',';
+				}
+				AppendJsonString (event.values [i].first, out);
+				out += ':';
+				AppendJsonNumber (event.values [i].second, out);
+			}
+			out += '}';
+			break;
+		}
+
+		out += '}';
+	}
+
+	void WriteFooter (std::string& out) override
+	{
+		out += "\n]}\n";
+	}
+
+private:
+	bool	first_;
+};
+
+// Protobuf wire format, see https://developers.google.com/protocol-buffers/docs/encoding
+// Field numbers are taken from perfetto/trace/trace_packet.proto and
+// perfetto/trace/track_event/*.proto
+namespace Proto {
+enum WireType
+{
+	Varint = 0,
+	Fixed64 = 1,
+	LengthDelimited = 2
+};
+
+void AppendVarint (std::uint64_t value, std::string& out)
+{
+	while (value >= 0x80) {
+		out += static_cast<char> ((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	out += static_cast<char> (value);
+}
+
+void AppendTag (const std::uint32_t field, const WireType type, std::string& out)
+{
+	AppendVarint ((field << 3) | type, out);
+}
+
+void AppendVarintField (const std::uint32_t field, const std::uint64_t value, std::string& out)
+{
+	AppendTag (field, Varint, out);
+	AppendVarint (value, out);
+}
+
+void AppendBytesField (const std::uint32_t field, const std::string& value, std::string& out)
+{
+	AppendTag (field, LengthDelimited, out);
+	AppendVarint (value.size (), out);
+	out += value;
+}
+
+void AppendDoubleField (const std::uint32_t field, const double value, std::string& out)
+{
+	AppendTag (field, Fixed64, out);
+	char bytes [sizeof (double)];
+	::memcpy (bytes, &value, sizeof (double));
+	// Wire format is little endian, as are all platforms we support
+	out.append (bytes, sizeof (double));
+}
+}
+
+class PerfettoWriter : public TraceWriter
+{
+public:
+	PerfettoWriter ()
+	: nextTrackUuid_ (ScopeTrackUuid + 1)
+	, first_ (true)
+	{
+	}
+
+	void WriteHeader (std::string& out) override
+	{
+		std::string descriptor;
+		Proto::AppendVarintField (TrackDescriptor_Uuid, ScopeTrackUuid, descriptor);
+		Proto::AppendBytesField (TrackDescriptor_Name, "GPUPerfAPI", descriptor);
+
+		std::string packet;
+		Proto::AppendBytesField (TracePacket_TrackDescriptor, descriptor, packet);
+		WritePacket (packet, out);
+	}
+
+	void WriteEvent (const Event& event, std::string& out) override
+	{
+		switch (event.type) {
+		case EventType::SliceBegin:
+			WriteTrackEvent (event.timestamp, TrackEvent_TypeSliceBegin,
+				ScopeTrackUuid, &event.name, nullptr, out);
+			break;
+		case EventType::SliceEnd:
+			WriteTrackEvent (event.timestamp, TrackEvent_TypeSliceEnd,
+				ScopeTrackUuid, nullptr, nullptr, out);
+			break;
+		case EventType::Counter:
+			for (const auto& value : event.values) {
+				const auto uuid = GetCounterTrack (event.name + "/" + value.first, out);
+				WriteTrackEvent (event.timestamp, TrackEvent_TypeCounter,
+					uuid, nullptr, &value.second, out);
+			}
+			break;
+		}
+	}
+
+	void WriteFooter (std::string&) override
+	{
+	}
+
+private:
+	enum
+	{
+		Trace_Packet						= 1,
+
+		TracePacket_Timestamp				= 8,
+		TracePacket_TrustedSequenceId		= 10,
+		TracePacket_TrackEvent				= 11,
+		TracePacket_SequenceFlags			= 13,
+		TracePacket_TimestampClockId		= 58,
+		TracePacket_TrackDescriptor			= 60,
+
+		TrackDescriptor_Uuid				= 1,
+		TrackDescriptor_Name				= 2,
+		TrackDescriptor_Counter				= 8,
+
+		TrackEvent_Type						= 9,
+		TrackEvent_TrackUuid				= 11,
+		TrackEvent_Name						= 23,
+		TrackEvent_DoubleCounterValue		= 44,
+
+		TrackEvent_TypeSliceBegin			= 1,
+		TrackEvent_TypeSliceEnd				= 2,
+		TrackEvent_TypeCounter				= 4,
+
+		SequenceFlags_IncrementalStateCleared	= 1,
+
+		// steady_clock is CLOCK_MONOTONIC on Linux
+		BuiltinClock_Monotonic				= 3,
+
+		SequenceId							= 1,
+		ScopeTrackUuid						= 1
+	};
+
+	void WritePacket (std::string& packet, std::string& out)
+	{
+		Proto::AppendVarintField (TracePacket_TrustedSequenceId, SequenceId, packet);
+
+		if (first_) {
+			Proto::AppendVarintField (TracePacket_SequenceFlags,
+				SequenceFlags_IncrementalStateCleared, packet);
+			first_ = false;
+		}
+
+		Proto::AppendBytesField (Trace_Packet, packet, out);
+	}
+
+	void WriteTrackEvent (const std::uint64_t timestamp, const int type,
+		const std::uint64_t trackUuid, const std::string* name,
+		const double* value, std::string& out)
+	{
+		std::string trackEvent;
+		Proto::AppendVarintField (TrackEvent_Type, type, trackEvent);
+		Proto::AppendVarintField (TrackEvent_TrackUuid, trackUuid, trackEvent);
+
+		if (name) {
+			Proto::AppendBytesField (TrackEvent_Name, *name, trackEvent);
+		}
+
+		if (value) {
+			Proto::AppendDoubleField (TrackEvent_DoubleCounterValue, *value, trackEvent);
+		}
+
+		std::string packet;
+		Proto::AppendVarintField (TracePacket_Timestamp, timestamp, packet);
+		Proto::AppendVarintField (TracePacket_TimestampClockId, BuiltinClock_Monotonic, packet);
+		Proto::AppendBytesField (TracePacket_TrackEvent, trackEvent, packet);
+		WritePacket (packet, out);
+	}
+
+	std::uint64_t GetCounterTrack (const std::string& name, std::string& out)
+	{
+		auto it = counterTracks_.find (name);
+
+		if (it != counterTracks_.end ()) {
+			return it->second;
+		}
+
+		const auto uuid = nextTrackUuid_++;
+		counterTracks_.emplace (name, uuid);
+
+		std::string descriptor;
+		Proto::AppendVarintField (TrackDescriptor_Uuid, uuid, descriptor);
+		Proto::AppendBytesField (TrackDescriptor_Name, name, descriptor);
+		// An empty CounterDescriptor marks this as a counter track
+		Proto::AppendBytesField (TrackDescriptor_Counter, std::string (), descriptor);
+
+		std::string packet;
+		Proto::AppendBytesField (TracePacket_TrackDescriptor, descriptor, packet);
+		WritePacket (packet, out);
+
+		return uuid;
+	}
+
+	std::map<std::string, std::uint64_t>	counterTracks_;
+	std::uint64_t							nextTrackUuid_;
+	bool									first_;
+};
+}
+
+struct TraceExporter::Impl
+{
+	Impl (const std::string& filename, const TraceFormat::Enum format)
+	: passIndex_ (0)
+	, submitted_ (0)
+	, written_ (0)
+	, stop_ (false)
+	{
+		file_.open (filename, std::ios::binary | std::ios::trunc);
+
+		if (!file_) {
+			throw std::runtime_error ("Could not open trace file: " + filename);
+		}
+
+		switch (format) {
+		case TraceFormat::ChromeJson:	writer_.reset (new ChromeJsonWriter); break;
+		case TraceFormat::Perfetto:		writer_.reset (new PerfettoWriter); break;
+		default:
+			throw std::runtime_error ("Unsupported trace format.");
+		}
+
+		std::string header;
+		writer_->WriteHeader (header);
+		file_.write (header.data (), header.size ());
+
+		thread_ = std::thread (&Impl::Run, this);
+	}
+
+	~Impl ()
+	{
+		Release (true);
+
+		if (!sessions_.empty ()) {
+			Write (std::move (sessions_.front ().events));
+			sessions_.clear ();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			stop_ = true;
+		}
+		wakeWriter_.notify_one ();
+		thread_.join ();
+
+		std::string footer;
+		writer_->WriteFooter (footer);
+		file_.write (footer.data (), footer.size ());
+	}
+
+	/**
+	Absolute, so traces can be lined up with CPU traces using the same clock.
+	*/
+	std::uint64_t Now () const
+	{
+		return static_cast<std::uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (
+			std::chrono::steady_clock::now ().time_since_epoch ()).count ());
+	}
+
+	/**
+	Hand events to the writer thread.
+	*/
+	void Write (std::vector<Event>&& events)
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			submitted_ += events.size ();
+			pending_.insert (pending_.end (),
+				std::make_move_iterator (events.begin ()),
+				std::make_move_iterator (events.end ()));
+		}
+		wakeWriter_.notify_one ();
+	}
+
+	void PushSlice (const EventType::Enum type, const std::uint64_t timestamp,
+		std::string&& name)
+	{
+		Event event;
+		event.type = type;
+		event.timestamp = timestamp;
+		event.name = std::move (name);
+
+		if (sessions_.empty () || sessions_.back ().ended) {
+			// Outside of a session, nothing to wait for
+			std::vector<Event> events;
+			events.push_back (std::move (event));
+			Write (std::move (events));
+		} else {
+			sessions_.back ().events.push_back (std::move (event));
+		}
+	}
+
+	SessionEvents* FindSession (const std::uint32_t sessionId)
+	{
+		for (auto& session : sessions_) {
+			if (session.id == sessionId) {
+				return &session;
+			}
+		}
+
+		return nullptr;
+	}
+
+	/**
+	Write sessions from the front which are complete, or all ended ones if
+	force is set. Results arriving later for them are dropped.
+	*/
+	void Release (const bool force)
+	{
+		std::size_t ended = 0;
+		for (const auto& session : sessions_) {
+			if (session.ended) {
+				++ended;
+			}
+		}
+
+		while (!sessions_.empty () && sessions_.front ().ended
+			&& (force || sessions_.front ().sampleEnds.empty () || ended > MaxHeldSessions)) {
+			auto& events = sessions_.front ().events;
+			std::stable_sort (events.begin (), events.end (),
+				[] (const Event& a, const Event& b) { return a.timestamp < b.timestamp; });
+
+			Write (std::move (events));
+			sessions_.pop_front ();
+			--ended;
+		}
+	}
+
+	std::string GetSampleName (const std::uint32_t sampleId) const
+	{
+		auto it = sampleNames_.find (sampleId);
+
+		if (it == sampleNames_.end ()) {
+			return "Sample " + std::to_string (sampleId);
+		} else {
+			return it->second;
+		}
+	}
+
+	void Flush ()
+	{
+		Release (true);
+
+		std::unique_lock<std::mutex> lock (mutex_);
+		const auto target = submitted_;
+		flushed_.wait (lock, [this, target] () { return written_ >= target; });
+	}
+
+	void Run ()
+	{
+		std::vector<Event> events;
+		std::string buffer;
+
+		for (;;) {
+			bool stop = false;
+			{
+				std::unique_lock<std::mutex> lock (mutex_);
+				wakeWriter_.wait (lock, [this] () { return stop_ || !pending_.empty (); });
+				events.swap (pending_);
+				stop = stop_;
+			}
+
+			buffer.clear ();
+			for (const auto& event : events) {
+				writer_->WriteEvent (event, buffer);
+			}
+
+			file_.write (buffer.data (), buffer.size ());
+			file_.flush ();
+
+			{
+				std::lock_guard<std::mutex> lock (mutex_);
+				written_ += events.size ();
+			}
+			flushed_.notify_all ();
+			events.clear ();
+
+			if (stop) {
+				std::lock_guard<std::mutex> lock (mutex_);
+				if (pending_.empty ()) {
+					break;
+				}
+			}
+		}
+	}
+
+	// Owned by the thread issuing the GPA calls
+	int										passIndex_;
+	std::map<std::uint32_t, std::string>	sampleNames_;
+	std::deque<SessionEvents>				sessions_;		///< Oldest first
+
+	// Shared with the writer thread
+	std::mutex								mutex_;
+	std::condition_variable					wakeWriter_;
+	std::condition_variable					flushed_;
+	std::vector<Event>						pending_;
+	std::uint64_t							submitted_;
+	std::uint64_t							written_;
+	bool									stop_;
+
+	// Owned by the writer thread
+	std::ofstream							file_;
+	std::unique_ptr<TraceWriter>			writer_;
+
+	std::thread								thread_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+TraceExporter::TraceExporter (const std::string& filename, const TraceFormat::Enum format)
+: impl_ (new Impl (filename, format))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TraceExporter::~TraceExporter ()
+{
+	delete impl_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::SetSampleName (const std::uint32_t sampleId, const std::string& name)
+{
+	impl_->sampleNames_ [sampleId] = name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::Flush ()
+{
+	impl_->Flush ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::OnBeginSession (const std::uint32_t sessionId)
+{
+	SessionEvents session;
+	session.id = sessionId;
+	session.ended = false;
+	impl_->sessions_.push_back (std::move (session));
+
+	impl_->passIndex_ = 0;
+	impl_->PushSlice (EventType::SliceBegin, impl_->Now (),
+		"Session " + std::to_string (sessionId));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::OnEndSession (const std::uint32_t)
+{
+	impl_->PushSlice (EventType::SliceEnd, impl_->Now (), std::string ());
+
+	if (!impl_->sessions_.empty ()) {
+		impl_->sessions_.back ().ended = true;
+		impl_->Release (false);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::OnBeginPass ()
+{
+	impl_->PushSlice (EventType::SliceBegin, impl_->Now (),
+		"Pass " + std::to_string (impl_->passIndex_++));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::OnEndPass ()
+{
+	impl_->PushSlice (EventType::SliceEnd, impl_->Now (), std::string ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::OnBeginSample (const std::uint32_t sampleId)
+{
+	impl_->PushSlice (EventType::SliceBegin, impl_->Now (),
+		impl_->GetSampleName (sampleId));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::OnEndSample (const std::uint32_t sampleId)
+{
+	const auto now = impl_->Now ();
+
+	// With multiple passes, the last pass determines where the counters go
+	if (!impl_->sessions_.empty () && !impl_->sessions_.back ().ended) {
+		impl_->sessions_.back ().sampleEnds [sampleId] = now;
+	}
+
+	impl_->PushSlice (EventType::SliceEnd, now, std::string ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TraceExporter::OnSampleResult (const std::uint32_t sessionId,
+	const std::uint32_t sampleId, const SessionResult& result)
+{
+	SessionEvents* session = impl_->FindSession (sessionId);
+
+	if (session == nullptr) {
+		// Session was not recorded while this exporter was installed, or has
+		// been written already
+		return;
+	}
+
+	auto it = session->sampleEnds.find (sampleId);
+
+	if (it == session->sampleEnds.end ()) {
+		// Results have been exported already
+		return;
+	}
+
+	Event event;
+	event.type = EventType::Counter;
+	event.timestamp = it->second;
+	event.name = impl_->GetSampleName (sampleId);
+	event.values.reserve (result.size ());
+
+	for (const auto& kv : result) {
+		event.values.emplace_back (kv.first, ToDouble (kv.second));
+	}
+
+	session->sampleEnds.erase (it);
+	session->events.push_back (std::move (event));
+
+	impl_->Release (false);
+}
+}
@@ -0,0 +1,72 @@
+#ifndef NIV_AMD_PERF_LIB_TRACEEXPORTER_H_CD57F877_D248_419D_AADB_066F75AB5391
+#define NIV_AMD_PERF_LIB_TRACEEXPORTER_H_CD57F877_D248_419D_AADB_066F75AB5391
+
+#include "PerfLib.h"
+
+namespace Amd {
+struct TraceFormat
+{
+	enum Enum
+	{
+		ChromeJson,	///< Chrome Trace Event JSON, loadable in chrome://tracing and Perfetto
+		Perfetto	///< Perfetto protobuf trace
+	};
+};
+
+/**
+Writes sessions, passes and samples as slices, and sample results as counter
+tracks, to a trace file.
+
+Install it using PerformanceLibrary::SetListener. Timestamps are taken on the
+thread issuing the GPA calls when the scope begins or ends; counter values are
+placed at the end of their sample. Timestamps are std::chrono::steady_clock
+time, which is CLOCK_MONOTONIC on Linux, so the trace lines up with CPU traces
+taken with the same clock. Formatting and file output happen on a background
+thread.
+
+To keep events in timestamp order, the events of a session are held back
+until the results of all its samples have been read back. At most 64 ended
+sessions are held; beyond that, the oldest one is written without the
+results which are still missing, and they are dropped if read later.
+*/
+class TraceExporter : public SessionListener
+{
+public:
+	// Noncopyable
+	TraceExporter (const TraceExporter& other) = delete;
+	TraceExporter& operator= (const TraceExporter& other) = delete;
+
+	TraceExporter (const std::string& filename, const TraceFormat::Enum format);
+	~TraceExporter ();
+
+	/**
+	Use name for all samples with the given id, instead of "Sample <id>".
+	*/
+	void SetSampleName (const std::uint32_t sampleId, const std::string& name);
+
+	/**
+	Block until all events recorded so far have been written, including those
+	of sessions whose results have not been read back yet. Must be called from
+	the thread issuing the GPA calls.
+	*/
+	void Flush ();
+
+	void OnBeginSession (const std::uint32_t sessionId) override;
+	void OnEndSession (const std::uint32_t sessionId) override;
+
+	void OnBeginPass () override;
+	void OnEndPass () override;
+
+	void OnBeginSample (const std::uint32_t sampleId) override;
+	void OnEndSample (const std::uint32_t sampleId) override;
+
+	void OnSampleResult (const std::uint32_t sessionId,
+		const std::uint32_t sampleId, const SessionResult& result) override;
+
+private:
+	struct Impl;
+	Impl*	impl_;
+};
+}
+
+#endif